@@ -30,6 +30,8 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <cstdlib>
+#include <new>
 #include "spdlog/spdlog.h"
 #include "spdlog/async_logger.h"
 #include "spdlog/sinks/file_sinks.h"
@@ -46,6 +48,84 @@ using namespace utils;
 
 void bench(int howmany, std::shared_ptr<spdlog::logger> log);
 void bench_mt(int howmany, std::shared_ptr<spdlog::logger> log, int thread_count);
+void bench_allocs(int howmany, const std::string& msg);
+void bench_loggers(int howmany, int logger_count);
+void bench_disabled(int howmany);
+void bench_formatter(int howmany, const std::string& pattern);
+template<typename Pattern>
+void bench_static_formatter(int howmany);
+
+SPDLOG_STATIC_PATTERN(full_pattern, "%+");
+SPDLOG_STATIC_PATTERN(custom_pattern, "[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
+
+// count heap allocations to measure allocations per message.
+// all the replaceable allocation functions go to malloc/free, so every new is paired with a matching delete.
+// (gcc's -Wmismatched-new-delete can't tell that these new and delete are replaced together)
+static std::atomic<size_t> allocations {0};
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size, const std::nothrow_t&) SPDLOG_NOEXCEPT
+{
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* p = operator new(size, std::nothrow))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) SPDLOG_NOEXCEPT
+{
+    return operator new(size, tag);
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) SPDLOG_NOEXCEPT
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) SPDLOG_NOEXCEPT
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) SPDLOG_NOEXCEPT
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) SPDLOG_NOEXCEPT
+{
+    std::free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) SPDLOG_NOEXCEPT
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) SPDLOG_NOEXCEPT
+{
+    std::free(p);
+}
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
 
 int main(int argc, char* argv[])
 {
@@ -103,6 +183,56 @@ int main(int argc, char* argv[])
             bench_mt(howmany, as, threads);
             spdlog::drop("as");
         }
+
+        cout << "\n*******************************************************************************\n";
+        cout << "async logging.. " << threads << " threads, per producer queues (round robin)" << endl;
+        cout << "*******************************************************************************\n";
+
+        // every producer thread gets its own ring of the given size
+        size_t ring_size = 1;
+        while (ring_size * 2 <= static_cast<size_t>(queue_size / threads))
+            ring_size *= 2;
+        spdlog::set_async_mode(ring_size, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(), spdlog::async_queue_type::spsc_round_robin);
+
+        for(int i = 0; i < 3; ++i)
+        {
+            auto as = spdlog::daily_logger_st("as", "logs/daily_async", auto_flush);
+            bench_mt(howmany, as, threads);
+            spdlog::drop("as");
+        }
+
+        cout << "\n*******************************************************************************\n";
+        cout << "async logging.. 1 thread round robin over loggers, per producer queues (round robin)" << endl;
+        cout << "*******************************************************************************\n";
+
+        // each logger has its own queue, and each queue its own ring of the producer thread
+        spdlog::set_async_mode(8192, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(), spdlog::async_queue_type::spsc_round_robin);
+        bench_loggers(howmany, 1);
+        bench_loggers(howmany, 16);
+
+        cout << "\n*******************************************************************************\n";
+        cout << "async logging heap allocations per message (caller + worker threads)" << endl;
+        cout << "*******************************************************************************\n";
+
+        spdlog::set_async_mode(queue_size);
+        bench_allocs(howmany, "Hello logger: msg number");
+        bench_allocs(howmany, std::string(300, 'x'));
+
+        cout << "\n*******************************************************************************\n";
+        cout << "disabled log calls (debug messages to an info logger), " << format(howmany) << " iterations" << endl;
+        cout << "*******************************************************************************\n";
+
+        bench_disabled(howmany);
+
+        cout << "\n*******************************************************************************\n";
+        cout << "pattern formatting only (no sinks), " << format(howmany) << " iterations" << endl;
+        cout << "*******************************************************************************\n";
+
+        bench_formatter(howmany, "%+");
+        bench_formatter(howmany, "[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
+        bench_formatter(howmany, "%D %T.%f %z [%L] [%t] %v");
+        bench_static_formatter<full_pattern>(howmany);
+        bench_static_formatter<custom_pattern>(howmany);
     }
     catch (std::exception &ex)
     {
@@ -160,3 +290,112 @@ void bench_mt(int howmany, std::shared_ptr<spdlog::logger> log, int thread_count
     auto delta_d = duration_cast<duration<double>> (delta).count();
     cout << format(int(howmany / delta_d)) << "/sec" << endl;
 }
+
+
+void bench_allocs(int howmany, const std::string& msg)
+{
+    auto log = spdlog::create<null_sink_mt>("allocs");
+    cout << msg.size() << " bytes msgs...\t" << flush;
+    auto allocs_before = allocations.load();
+    for (auto i = 0; i < howmany; ++i)
+    {
+        log->info("{} {}", msg, i);
+    }
+    // wait for the worker to process all messages
+    spdlog::drop("allocs");
+    log.reset();
+
+    auto allocs = allocations.load() - allocs_before;
+    cout << format(double(allocs) / howmany) << " allocs/msg" << endl;
+}
+
+
+void bench_loggers(int howmany, int logger_count)
+{
+    cout << logger_count << " loggers...\t\t" << flush;
+    vector<std::shared_ptr<spdlog::logger>> loggers;
+    for (int i = 0; i < logger_count; ++i)
+        loggers.push_back(spdlog::create<null_sink_mt>("loggers_" + std::to_string(i)));
+
+    auto start = system_clock::now();
+    for (auto i = 0; i < howmany; ++i)
+        loggers[i % logger_count]->info("Hello logger: msg number {}", i);
+    // wait for the workers to process all messages
+    for (auto& log : loggers)
+        spdlog::drop(log->name());
+    loggers.clear();
+
+    auto delta = system_clock::now() - start;
+    auto delta_d = duration_cast<duration<double>> (delta).count();
+    cout << format(int(howmany / delta_d)) << "/sec" << endl;
+}
+
+
+template<typename LogCall>
+void bench_disabled(int howmany, const std::string& title, LogCall log_call)
+{
+    cout << title << "...\t" << flush;
+    auto start = system_clock::now();
+    for (auto i = 0; i < howmany; ++i)
+        log_call(i);
+
+    auto delta = system_clock::now() - start;
+    auto delta_ns = duration_cast<duration<double, std::nano>> (delta).count();
+    cout << delta_ns / howmany << " ns/call" << endl;
+}
+
+void bench_disabled(int howmany)
+{
+    auto log = std::make_shared<spdlog::logger>("disabled", std::make_shared<null_sink_st>());
+    log->set_level(level::info);
+    bench_disabled(howmany, "debug(fmt, args)", [&](int i)
+    {
+        log->debug("Hello logger: msg number {}", i);
+    });
+    bench_disabled(howmany, "debug() << args", [&](int i)
+    {
+        log->debug() << "Hello logger: msg number " << i;
+    });
+    bench_disabled(howmany, "debug(fmt, to_string(i))", [&](int i)
+    {
+        log->debug("Hello logger: msg number {}", std::to_string(i));
+    });
+    bench_disabled(howmany, "SPDLOG_LOGGER_DEBUG(fmt, to_string(i))", [&](int i)
+    {
+        SPDLOG_LOGGER_DEBUG(log, "Hello logger: msg number {}", std::to_string(i));
+    });
+}
+
+
+template<typename Formatter>
+void bench_formatter(int howmany, const std::string& title, Formatter& formatter)
+{
+    cout << title << "...\t" << flush;
+    details::log_msg msg(level::info);
+    msg.logger_name = "formatter";
+    msg.raw << "Hello logger: msg number 123456";
+    auto start = system_clock::now();
+    for (auto i = 0; i < howmany; ++i)
+    {
+        msg.time = log_clock::now();
+        msg.formatted.clear();
+        formatter.format(msg);
+    }
+
+    auto delta = system_clock::now() - start;
+    auto delta_d = duration_cast<duration<double>> (delta).count();
+    cout << format(int(howmany / delta_d)) << "/sec" << endl;
+}
+
+void bench_formatter(int howmany, const std::string& pattern)
+{
+    spdlog::pattern_formatter formatter(pattern);
+    bench_formatter(howmany, pattern, formatter);
+}
+
+template<typename Pattern>
+void bench_static_formatter(int howmany)
+{
+    spdlog::static_pattern_formatter<Pattern> formatter;
+    bench_formatter(howmany, std::string("static ") + Pattern::value(), formatter);
+}
@@ -76,6 +76,16 @@ int main(int, char*[])
         spd::set_pattern("*** [%H:%M:%S %z] [thread %t] %v ***");
         file_logger->info("This is another message with custom format");
 
+        //
+        // Customize msg format per sink - a detailed file and a terse console from the same logger
+        //
+        auto detailed_sink = std::make_shared<spd::sinks::simple_file_sink_mt>("logs/detailed.txt");
+        detailed_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] [thread %t] %v");
+        auto terse_sink = std::make_shared<spd::sinks::stdout_sink_mt>();
+        terse_sink->set_pattern("%l: %v");
+        spd::logger multi_format_logger("multi_format", { detailed_sink, terse_sink });
+        multi_format_logger.info("Each sink of this logger has its own format");
+
         spd::get("console")->info("loggers can be retrieved from a global registry using the spdlog::get(logger_name) function");
 
         //
@@ -85,6 +95,12 @@ int main(int, char*[])
         SPDLOG_TRACE(console, "Enabled only #ifdef SPDLOG_TRACE_ON..{} ,{}", 1, 3.23);
         SPDLOG_DEBUG(console, "Enabled only #ifdef SPDLOG_DEBUG_ON.. {} ,{}", 1, 3.23);
 
+        //
+        // Level checked macros - compiled out below SPDLOG_ACTIVE_LEVEL, arguments evaluated only if the level is enabled
+        //
+        SPDLOG_LOGGER_DEBUG(console, "Compiled out if SPDLOG_ACTIVE_LEVEL > SPDLOG_LEVEL_DEBUG.. {}", 42);
+        SPDLOG_LOGGER_WARN(console, "Source location of this call is kept for free..");
+
         //
         // Asynchronous logging is very fast..
         // Just call spdlog::set_async_mode(q_size) and all created loggers from now on will be asynchronous..
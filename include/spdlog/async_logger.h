@@ -26,7 +26,7 @@
 
 // Very fast asynchronous logger (millions of logs per second on an average desktop)
 // Uses pre allocated lockfree queue for maximum throughput even under large number of threads.
-// Creates a single back thread to pop messages from the queue and log them.
+// Creates a single back thread to pop messages from the queue and log them (or uses a worker pool shared with other loggers).
 //
 // Upon each log write the logger:
 //    1. Checks if its log level is enough to log the message
@@ -47,6 +47,7 @@ namespace spdlog
 namespace details
 {
 class async_log_helper;
+struct async_log_route;
 }
 
 class async_logger :public logger
@@ -58,31 +59,56 @@ public:
                  const It& end,
                  size_t queue_size,
                  const async_overflow_policy overflow_policy =  async_overflow_policy::block_retry,
-                 const std::function<void()>& worker_warmup_cb = nullptr,
-                 const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero());
+                 const worker_warmup_callback& worker_warmup_cb = nullptr,
+                 const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
+                 const async_queue_type queue_type = async_queue_type::mpmc,
+                 const async_wait_strategy wait_strategy = async_wait_strategy::backoff,
+                 size_t worker_threads = 1);
 
     async_logger(const std::string& logger_name,
                  sinks_init_list sinks,
                  size_t queue_size,
                  const async_overflow_policy overflow_policy = async_overflow_policy::block_retry,
-                 const std::function<void()>& worker_warmup_cb = nullptr,
-                 const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero());
+                 const worker_warmup_callback& worker_warmup_cb = nullptr,
+                 const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
+                 const async_queue_type queue_type = async_queue_type::mpmc,
+                 const async_wait_strategy wait_strategy = async_wait_strategy::backoff,
+                 size_t worker_threads = 1);
 
     async_logger(const std::string& logger_name,
                  sink_ptr single_sink,
                  size_t queue_size,
                  const async_overflow_policy overflow_policy =  async_overflow_policy::block_retry,
-                 const std::function<void()>& worker_warmup_cb = nullptr,
-                 const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero());
+                 const worker_warmup_callback& worker_warmup_cb = nullptr,
+                 const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
+                 const async_queue_type queue_type = async_queue_type::mpmc,
+                 const async_wait_strategy wait_strategy = async_wait_strategy::backoff,
+                 size_t worker_threads = 1);
+
+    // log using the given async helper, possibly shared with other loggers
+    template<class It>
+    async_logger(const std::string& name,
+                 const It& begin,
+                 const It& end,
+                 std::shared_ptr<details::async_log_helper> async_log_helper);
+
+    // waits until all messages of this logger are logged
+    ~async_logger();
+
+    // snapshot of the queue counters (depth, high water mark, enqueued/dropped messages, producers block time)
+    async_stats stats() const;
 
 
 protected:
     void _log_msg(details::log_msg& msg) override;
     void _set_formatter(spdlog::formatter_ptr msg_formatter) override;
     void _set_pattern(const std::string& pattern) override;
+    // blocks until the messages logged so far are written and the sinks flushed by the worker threads
+    void _flush() override;
 
 private:
-    std::unique_ptr<details::async_log_helper> _async_log_helper;
+    std::shared_ptr<details::async_log_helper> _async_log_helper;
+    details::async_log_route* _route;
 };
 }
 
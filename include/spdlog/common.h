@@ -28,6 +28,18 @@
 #include <initializer_list>
 #include <chrono>
 #include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+//inline buffer size of log_msg's raw and formatted writers (see tweakme.h)
+#if defined(SPDLOG_LOG_MSG_INLINE_SIZE) && !defined(FMT_INLINE_BUFFER_SIZE)
+#define FMT_INLINE_BUFFER_SIZE SPDLOG_LOG_MSG_INLINE_SIZE
+#endif
+
+//name of the enclosing function, for source_loc
+#define SPDLOG_FUNCTION __FUNCTION__
 
 //visual studio does not support noexcept yet
 #ifndef _MSC_VER
@@ -36,6 +48,20 @@
 #define SPDLOG_NOEXCEPT throw()
 #endif
 
+//visual studio 2013 does not support constexpr
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define SPDLOG_CONSTEXPR
+#else
+#define SPDLOG_CONSTEXPR constexpr
+#endif
+
+//visual studio 2013 does not support thread_local (only for POD types using __declspec(thread))
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define SPDLOG_THREAD_LOCAL __declspec(thread)
+#else
+#define SPDLOG_THREAD_LOCAL thread_local
+#endif
+
 
 namespace spdlog
 {
@@ -54,6 +80,18 @@ using sinks_init_list = std::initializer_list < sink_ptr >;
 using formatter_ptr = std::shared_ptr<spdlog::formatter>;
 
 
+//Numeric log levels, for compile time level checks by the preprocessor (see SPDLOG_ACTIVE_LEVEL in tweakme.h)
+#define SPDLOG_LEVEL_TRACE 0
+#define SPDLOG_LEVEL_DEBUG 1
+#define SPDLOG_LEVEL_INFO 2
+#define SPDLOG_LEVEL_NOTICE 3
+#define SPDLOG_LEVEL_WARN 4
+#define SPDLOG_LEVEL_ERROR 5
+#define SPDLOG_LEVEL_CRITICAL 6
+#define SPDLOG_LEVEL_ALERT 7
+#define SPDLOG_LEVEL_EMERG 8
+#define SPDLOG_LEVEL_OFF 9
+
 //Log level enum
 namespace level
 {
@@ -84,16 +122,154 @@ inline const char* to_short_str(spdlog::level::level_enum l)
 {
     return short_level_names[l];
 }
+static_assert(trace == SPDLOG_LEVEL_TRACE && emerg == SPDLOG_LEVEL_EMERG && off == SPDLOG_LEVEL_OFF, "SPDLOG_LEVEL_* must match level_enum");
 } //level
 
 
+//
+// Static metadata of a log call site: where it is and what it logs.
+// Defined by the SPDLOG_LOGGER_* macros once per call site (constant initialized static storage),
+// so messages only carry a pointer to it. Rendered by the %@ %s %g %# %! pattern flags.
+//
+struct source_loc
+{
+    const char* filename;
+    int line;
+    const char* funcname;
+    level::level_enum level;
+    const char* fmt; // the format string literal, null if not a literal
+
+    // assigned on first use by id(). ids are unique within the process
+    mutable std::atomic<unsigned> site_id;
+
+    // small id of the call site, e.g. for binary sinks to write instead of the strings above.
+    // costs a relaxed load once assigned.
+    unsigned id() const
+    {
+        auto current = site_id.load(std::memory_order_relaxed);
+        if (current)
+            return current;
+
+        static std::atomic<unsigned> next_id(1);
+        unsigned new_id = next_id.fetch_add(1, std::memory_order_relaxed);
+        if (site_id.compare_exchange_strong(current, new_id, std::memory_order_relaxed))
+            return new_id;
+        return current; // assigned meanwhile by another thread
+    }
+};
+
+namespace details
+{
+// the format string of a call site if it is a literal, null otherwise
+template<size_t N>
+inline SPDLOG_CONSTEXPR const char* literal_fmt(const char (&fmt)[N])
+{
+    return fmt;
+}
+
+template<size_t N>
+inline SPDLOG_CONSTEXPR const char* literal_fmt(char (&)[N])
+{
+    return nullptr;
+}
+
+template<typename T>
+inline SPDLOG_CONSTEXPR const char* literal_fmt(const T&)
+{
+    return nullptr;
+}
+}
+
+
 //
 // Async overflow policy - block by default.
 //
 enum class async_overflow_policy
 {
     block_retry, // Block / yield / sleep until message can be enqueued
-    discard_log_msg // Discard the message it enqueue fails
+    discard_log_msg, // Discard the message it enqueue fails
+    discard_by_level // Discard trace/debug/info above the queue watermark and notice/warn if the queue is full. Block for err and above
+};
+
+//
+// Async queue type - mpmc by default.
+//
+enum class async_queue_type
+{
+    mpmc, // Single lockfree queue shared by all producer threads
+    spsc_round_robin, // Queue per producer thread (each of queue_size entries), drained in round robin order
+    spsc_timestamp // Queue per producer thread (each of queue_size entries), drained in timestamp order
+};
+
+//
+// Async wait strategy - how the worker thread waits for new messages, backoff by default.
+//
+enum class async_wait_strategy
+{
+    busy_spin, // Never give up the cpu - lowest latency, burns a core
+    backoff, // Spin / yield / sleep according to the time since the last message
+    blocking // Sleep on a condition variable, producers wake the worker only if it is parked
+};
+
+//
+// Async logger statistics - a snapshot of the queue counters.
+// With several worker threads, each has its own queue and gets its own copy of every message: the counters cover all of them.
+// Loggers sharing a worker pool report the counters of the whole pool.
+//
+struct async_stats
+{
+    size_t queue_depth = 0; // messages waiting in the queue
+    size_t high_water_mark = 0; // max queue depth seen by the worker threads
+    uint64_t enqueued = 0; // messages enqueued so far (approximation while logging is in progress)
+    uint64_t dropped = 0; // messages discarded by the overflow policy
+    std::chrono::nanoseconds total_block_time = std::chrono::nanoseconds::zero(); // time spent by producers waiting for room in the queue (block_retry policy)
+    std::chrono::nanoseconds max_block_time = std::chrono::nanoseconds::zero(); // longest single wait
+};
+
+//
+// Async worker warmup callback - called in each worker thread upon start.
+// Accepts either a void() callable or a void(size_t worker_index) callable.
+//
+class worker_warmup_callback
+{
+public:
+    worker_warmup_callback(std::nullptr_t = nullptr) {}
+
+    worker_warmup_callback(const std::function<void()>& cb)
+    {
+        if (cb)
+            _cb = [cb](size_t) { cb(); };
+    }
+
+    worker_warmup_callback(const std::function<void(size_t)>& cb) : _cb(cb) {}
+
+    template<typename F>
+    worker_warmup_callback(F cb) : _cb(make_cb(std::move(cb), 0)) {}
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(_cb);
+    }
+
+    void operator()(size_t worker_index) const
+    {
+        _cb(worker_index);
+    }
+
+private:
+    template<typename F>
+    static auto make_cb(F cb, int) -> decltype(cb(size_t()), std::function<void(size_t)>())
+    {
+        return cb;
+    }
+
+    template<typename F>
+    static std::function<void(size_t)> make_cb(F cb, long)
+    {
+        return [cb](size_t) { cb(); };
+    }
+
+    std::function<void(size_t)> _cb;
 };
 
 
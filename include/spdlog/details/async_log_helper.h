@@ -23,7 +23,11 @@
 /*************************************************************************/
 
 // async log helper :
-// Process logs asynchronously using a back thread.
+// Process logs asynchronously using back threads (one by default).
+// With several worker threads, each sink is served by one of them, so every sink still gets the messages in order.
+//
+// The helper can be shared by several loggers (see registry's shared_pool option).
+// Each logger adds a route (its name, formatter and sinks) and every queued message points to the route of its logger.
 //
 // If the internal queue of log messages reaches its max size,
 // then the client call will block until there is more room.
@@ -37,49 +41,146 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
 
 #include "../common.h"
 #include "../sinks/sink.h"
 #include "./mpmc_bounded_q.h"
+#include "./spsc_bounded_q.h"
 #include "./log_msg.h"
 #include "./format.h"
 #include "os.h"
 
 
+// Size of the text buffer inside each queue slot. Longer messages are allocated separately.
+#ifndef SPDLOG_ASYNC_MSG_INLINE_SIZE
+#define SPDLOG_ASYNC_MSG_INLINE_SIZE 256
+#endif
+
+// Max number of messages passed to the sinks at once.
+#ifndef SPDLOG_ASYNC_BATCH_SIZE
+#define SPDLOG_ASYNC_BATCH_SIZE 64
+#endif
+
+// Queue fill percentage above which the discard_by_level policy drops low level messages.
+#ifndef SPDLOG_ASYNC_DROP_WATERMARK
+#define SPDLOG_ASYNC_DROP_WATERMARK 75
+#endif
+
 namespace spdlog
 {
 namespace details
 {
 
+// Where the messages of one async logger go: its name, formatter and sinks.
+struct async_log_route
+{
+    // name of the owning logger. outlives the route.
+    const std::string* logger_name;
+    formatter_ptr formatter;
+
+    // the logger's sinks, by the index of the worker thread serving them
+    std::vector<std::vector<sink_ptr>> worker_sinks;
+
+    // messages of the route enqueued so far, and logged (or discarded) so far, per worker thread
+    struct message_counter
+    {
+        std::atomic<uint64_t> enqueued;
+        std::atomic<uint64_t> done;
+    };
+    std::unique_ptr<message_counter[]> counts;
+
+    // messages discarded by the overflow policy since the last "dropped" report, per worker thread
+    struct drop_counter
+    {
+        std::atomic<uint64_t> count;
+        std::atomic<log_clock::rep> first_drop_time; // time since epoch of the first discarded message
+    };
+    std::unique_ptr<drop_counter[]> drops;
+};
+
 class async_log_helper
 {
+    // Queue items are log messages or control tokens for the worker thread
+    enum class async_msg_type
+    {
+        log,
+        flush, // flush the route's sinks and signal the barrier
+        terminate // log the remaining messages and exit
+    };
+
+    // Signaled by each worker thread which reached its flush token, and logged the messages of the route
+    // enqueued before the flush (with per producer queues, other threads' messages may come after the token)
+    struct flush_barrier
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<bool> reached; // by worker index
+        std::vector<uint64_t> targets; // route's enqueued count at the flush, by worker index
+    };
+
     // Async msg to move to/from the queue
     // Movable only. should never be copied
+    //
+    // The message text is stored inline in the queue slot, so enqueue/dequeue do not allocate.
+    // Only texts longer than SPDLOG_ASYNC_MSG_INLINE_SIZE go to a side allocation.
+    // When deferred format args are present, they are stored in the inline buffer instead of the text,
+    // followed by a copy of the format string (which may not outlive the call). If the format string
+    // does not fit there, the message is rendered right away instead.
+    // If the format string is the call site's (static), it is not copied (txt_size is 0) and the worker leaves the
+    // args unrendered for the sinks which accept them.
     struct async_msg
     {
-        std::string logger_name;
+        static const size_t inline_size = SPDLOG_ASYNC_MSG_INLINE_SIZE;
+        static_assert(inline_size >= sizeof(deferred_args), "SPDLOG_ASYNC_MSG_INLINE_SIZE is too small to hold deferred format args");
+
+        async_msg_type msg_type;
+        async_log_route* route;
+        flush_barrier* barrier;
         level::level_enum level;
         log_clock::time_point time;
         size_t thread_id;
-        std::string txt;
+        const source_loc* source;
+        bool deferred;
+        size_t txt_size;
+        std::unique_ptr<char[]> overflow_txt;
+        char buf[inline_size];
 
         async_msg() = default;
         ~async_msg() = default;
 
 async_msg(async_msg&& other) SPDLOG_NOEXCEPT:
-        logger_name(std::move(other.logger_name)),
-                    level(std::move(other.level)),
+        msg_type(other.msg_type),
+                 route(other.route),
+                 barrier(other.barrier),
+                 level(other.level),
                     time(std::move(other.time)),
-                    txt(std::move(other.txt))
-        {}
+                    thread_id(other.thread_id),
+                    source(other.source),
+                    deferred(other.deferred),
+                    txt_size(other.txt_size),
+                    overflow_txt(std::move(other.overflow_txt))
+        {
+            copy_buf(other);
+        }
 
         async_msg& operator=(async_msg&& other) SPDLOG_NOEXCEPT
         {
-            logger_name = std::move(other.logger_name);
+            msg_type = other.msg_type;
+            route = other.route;
+            barrier = other.barrier;
             level = other.level;
             time = std::move(other.time);
             thread_id = other.thread_id;
-            txt = std::move(other.txt);
+            source = other.source;
+            deferred = other.deferred;
+            txt_size = other.txt_size;
+            overflow_txt = std::move(other.overflow_txt);
+            copy_buf(other);
             return *this;
         }
         // never copy or assign. should only be moved..
@@ -87,24 +188,126 @@ async_msg(async_msg&& other) SPDLOG_NOEXCEPT:
         async_msg& operator=(async_msg& other) = delete;
 
         // construct from log_msg
-        async_msg(const details::log_msg& m) :
-            logger_name(m.logger_name),
+        async_msg(const details::log_msg& m, async_log_route* msg_route) :
+            msg_type(async_msg_type::log),
+            route(msg_route),
+            barrier(nullptr),
             level(m.level),
             time(m.time),
             thread_id(m.thread_id),
-            txt(m.raw.data(), m.raw.size())
-        {}
+            source(m.source),
+            deferred(false),
+            txt_size(0)
+        {
+            if (m.deferred.empty())
+            {
+                set_txt(m.raw.data(), m.raw.size());
+                return;
+            }
+
+            if (m.source && m.source->fmt && (m.source->fmt == m.deferred.format_str || std::strcmp(m.source->fmt, m.deferred.format_str) == 0))
+            {
+                deferred = true;
+                std::memcpy(buf, &m.deferred, sizeof(deferred_args));
+                return;
+            }
+
+            // the format string with its terminating null
+            size_t fmt_size = std::strlen(m.deferred.format_str) + 1;
+            if (fmt_size <= inline_size - sizeof(deferred_args))
+            {
+                deferred = true;
+                txt_size = fmt_size;
+                std::memcpy(buf, &m.deferred, sizeof(deferred_args));
+                std::memcpy(buf + sizeof(deferred_args), m.deferred.format_str, fmt_size);
+            }
+            else
+            {
+                fmt::MemoryWriter rendered;
+                render_or_report(m.deferred, rendered);
+                set_txt(rendered.data(), rendered.size());
+            }
+        }
+
+        // construct a control token
+        async_msg(async_msg_type type, async_log_route* msg_route, flush_barrier* flush_barrier) :
+            msg_type(type),
+            route(msg_route),
+            barrier(flush_barrier),
+            level(level::off),
+            time(details::os::now()),
+            thread_id(0),
+            source(nullptr),
+            deferred(false),
+            txt_size(0) {}
 
 
         // copy into log_msg
         void fill_log_msg(log_msg &msg)
         {
             msg.clear();
-            msg.logger_name = logger_name;
+#ifndef SPDLOG_NO_NAME
+            msg.logger_name = *route->logger_name;
+#endif
             msg.level = level;
             msg.time = time;
             msg.thread_id = thread_id;
-            msg.raw << txt;
+            msg.source = source;
+            if (deferred)
+            {
+                std::memcpy(&msg.deferred, buf, sizeof(deferred_args));
+                msg.deferred.format_str = txt_size ? buf + sizeof(deferred_args) : source->fmt;
+                // the copied format string lives only as long as this queue item
+                if (txt_size)
+                    render_deferred(msg);
+            }
+            else
+                msg.raw << fmt::StringRef(overflow_txt ? overflow_txt.get() : buf, txt_size);
+        }
+
+        // render the deferred args (if any) of the message into its raw text
+        static void render_deferred(log_msg &msg)
+        {
+            if (msg.deferred.empty())
+                return;
+            render_or_report(msg.deferred, msg.raw);
+            msg.deferred.format_str = nullptr;
+        }
+
+    private:
+        // no one to throw to from the worker thread - log the formatting error instead
+        static void render_or_report(const deferred_args& args, fmt::MemoryWriter& w)
+        {
+            try
+            {
+                args.render(w);
+            }
+            catch (const spdlog_ex& ex)
+            {
+                w.clear();
+                w << ex.what();
+            }
+        }
+
+        void set_txt(const char* txt, size_t size)
+        {
+            txt_size = size;
+            if (txt_size <= inline_size)
+                std::memcpy(buf, txt, txt_size);
+            else
+            {
+                overflow_txt.reset(new char[txt_size]);
+                std::memcpy(overflow_txt.get(), txt, txt_size);
+            }
+        }
+
+        // copy only the used part of the inline buffer
+        void copy_buf(const async_msg& other)
+        {
+            if (other.deferred)
+                std::memcpy(buf, other.buf, sizeof(deferred_args) + other.txt_size);
+            else if (!other.overflow_txt && other.txt_size <= inline_size)
+                std::memcpy(buf, other.buf, other.txt_size);
         }
     };
 
@@ -112,58 +315,173 @@ public:
 
     using item_type = async_msg;
     using q_type = details::mpmc_bounded_queue<item_type>;
+    using spsc_q_type = details::per_producer_queue<item_type>;
 
     using clock = std::chrono::steady_clock;
 
 
-    async_log_helper(formatter_ptr formatter,
-                     const std::vector<sink_ptr>& sinks,
-                     size_t queue_size,
+    async_log_helper(size_t queue_size,
                      const async_overflow_policy overflow_policy = async_overflow_policy::block_retry,
-                     const std::function<void()>& worker_warmup_cb = nullptr,
-                     const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero());
+                     const worker_warmup_callback& worker_warmup_cb = nullptr,
+                     const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
+                     const async_queue_type queue_type = async_queue_type::mpmc,
+                     const async_wait_strategy wait_strategy = async_wait_strategy::backoff,
+                     size_t worker_threads = 1);
 
-    void log(const details::log_msg& msg);
+    // add the route of a logger using this helper. its sinks are spread over the worker threads
+    async_log_route* add_route(const std::string& logger_name, formatter_ptr formatter, const std::vector<sink_ptr>& sinks);
 
-    // stop logging and join the back thread
+    // wait until all messages of the route are logged and remove it
+    void remove_route(async_log_route* route);
+
+    void log(async_log_route& route, const details::log_msg& msg);
+
+    // block until all messages of the route logged before this call are written and its sinks flushed
+    void flush(async_log_route& route);
+
+    // stop logging and join the back threads
     ~async_log_helper();
 
-    void set_formatter(formatter_ptr);
+    void set_formatter(async_log_route& route, formatter_ptr);
+
+    // snapshot of the queue counters. can be called from any thread
+    async_stats stats();
 
 
 private:
-    formatter_ptr _formatter;
-    std::vector<std::shared_ptr<sinks::sink>> _sinks;
+    // A worker thread with its own queue, logging to its own share of the sinks of every route.
+    // Each sink belongs to exactly one worker, so its messages keep their order.
+    struct worker
+    {
+        size_t index;
+
+        // queue of messages to log - only one of them is used, depending on the queue type
+        std::unique_ptr<q_type> q;
+        std::unique_ptr<spsc_q_type> spsc_q;
+
+        // used by the blocking wait strategy - producers notify only if the worker is parked
+        std::mutex wait_mutex;
+        std::condition_variable wait_cv;
+        std::atomic<bool> parked;
 
-    // queue of messages to log
-    q_type _q;
+        // telemetry, written by the worker thread only
+        std::atomic<size_t> high_water_mark;
 
-    // last exception thrown from the worker thread
+        // message dequeued ahead, which belongs to the next batch (worker thread only)
+        async_msg next_msg;
+        bool has_next_msg;
+
+        // flush tokens waiting for messages enqueued before them to be logged (worker thread only)
+        std::vector<async_msg> waiting_flushes;
+
+        // set when the thread died on an exception. from then on it no longer touches any route or flush barrier
+        std::atomic<bool> failed;
+
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<worker>> _workers;
+
+    // routes of the loggers using this helper and the worker serving each sink.
+    // a sink shared by several loggers is always served by the same worker.
+    std::mutex _routes_mutex;
+    std::vector<std::unique_ptr<async_log_route>> _routes;
+    std::unordered_map<sinks::sink*, size_t> _sink_workers;
+    size_t _next_worker;
+
+    // queue depth above which the discard_by_level policy drops low level messages
+    const size_t _drop_watermark;
+
+    // last exception thrown from a worker thread, guarded by the mutex. _worker_failed is set once it is stored
+    std::mutex _workerthread_ex_mutex;
     std::shared_ptr<spdlog_ex> _last_workerthread_ex;
+    std::atomic<bool> _worker_failed;
+
+    // telemetry of the producers' slow path (queue full)
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _total_block_ns;
+    std::atomic<uint64_t> _max_block_ns;
+    std::atomic<uint64_t> _flush_tokens;
 
     // overflow policy
     const async_overflow_policy _overflow_policy;
 
     // worker thread warmup callback - one can set thread priority, affinity, etc
-    const std::function<void()> _worker_warmup_cb;
+    const worker_warmup_callback _worker_warmup_cb;
 
     // auto periodic sink flush parameter
     const std::chrono::milliseconds _flush_interval_ms;
 
-    // worker thread
-    std::thread _worker_thread;
+    // how the worker threads wait for messages when their queue is empty
+    const async_wait_strategy _wait_strategy;
 
     // throw last worker thread exception or if worker thread is not active
     void throw_if_bad_worker();
 
+    bool enqueue_msg(worker& w, async_msg&& msg);
+    bool dequeue_msg(worker& w, async_msg& msg);
+    size_t queue_size(worker& w);
+    size_t producer_queue_size(worker& w);
+
+    // try to push to the worker's queue and block until succeeded (unless the overflow policy is to discard)
+    // return true if the message was enqueued
+    bool push_msg(worker& w, async_msg&& new_msg);
+
+    // should the overflow policy discard the message rather than wait for room in the queue
+    bool discard_if_full(const async_msg& msg) const;
+
+    void record_drop(worker& w, const async_msg& msg);
+
+    // log a "dropped N messages since T" warning to the route's sinks, if its messages were discarded
+    void log_drops(worker& w, async_log_route& route);
+
+    // were messages of the route discarded and not reported yet
+    bool has_drops(const async_log_route& route) const;
+
+    // the flush barrier, without checking the worker threads for exceptions
+    void flush_route(async_log_route& route);
+
     // worker thread main loop
-    void worker_loop();
+    void worker_loop(worker& w);
+
+    // store the exception which ended the worker thread, to be thrown in the client's thread
+    void set_worker_failed(worker& w, const std::string& what);
+
+    // pop the next messages from the queue (up to a full batch) and process them
+    // return true if this thread should still be active (no terminate msg was received), will set the last_pop to the pop time
+    bool process_next_msgs(worker& w, log_batch& batch, log_clock::time_point& last_pop, log_clock::time_point& last_flush);
+
+    // process the worker's next message (a log message, with the following ones in a batch, or a flush token)
+    void process_msg(worker& w, log_batch& batch);
+
+    // fill the batch with the worker's next message and the following log messages of the same route,
+    // until it is full or the queue is empty.
+    // return the route of the batch
+    async_log_route& fill_batch(worker& w, log_batch& batch);
+
+    // flush the route's sinks served by the worker and signal the flush barrier,
+    // or keep the token until the route's messages enqueued before the flush are logged
+    void handle_flush_token(worker& w, async_msg& token);
+
+    // complete the waiting flush tokens whose messages are logged (or all of them)
+    void complete_waiting_flushes(worker& w, bool all = false);
+
+    void complete_flush(worker& w, async_msg& token);
 
-    // pop next message from the queue and process it
-    // return true if a message was available (queue was not empty), will set the last_pop to the pop time
-    bool process_next_msg(log_clock::time_point& last_pop, log_clock::time_point& last_flush);
+    // pass the batch to the route's sinks served by the worker, formatted once per distinct formatter of the sinks
+    void log_to_sinks(worker& w, async_log_route& route, log_batch& batch);
 
-    void handle_flush_interval(log_clock::time_point& now, log_clock::time_point& last_flush);
+    void handle_flush_interval(worker& w, log_clock::time_point& now, log_clock::time_point& last_flush);
+
+    // wait for new messages according to the wait strategy (the queue was found empty)
+    // return true if a message was dequeued into msg while waiting
+    bool wait_for_msg(worker& w, async_msg& msg, const log_clock::time_point& now, const log_clock::time_point& last_pop, const log_clock::time_point& last_flush);
+
+    // wake the worker thread if it is parked by the blocking wait strategy
+    void notify_worker(worker& w);
+
+    // format the messages of the batch and their concatenated text
+    static void format_batch(formatter& batch_formatter, log_batch& batch);
 
     // sleep,yield or return immediatly using the time passed since last message as a hint
     static void sleep_or_yield(const spdlog::log_clock::time_point& now, const log_clock::time_point& last_op_time);
@@ -177,38 +495,234 @@ private:
 ///////////////////////////////////////////////////////////////////////////////
 // async_sink class implementation
 ///////////////////////////////////////////////////////////////////////////////
-inline spdlog::details::async_log_helper::async_log_helper(formatter_ptr formatter, const std::vector<sink_ptr>& sinks, size_t queue_size, const async_overflow_policy overflow_policy, const std::function<void()>& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms):
-    _formatter(formatter),
-    _sinks(sinks),
-    _q(queue_size),
+inline spdlog::details::async_log_helper::async_log_helper(size_t queue_size, const async_overflow_policy overflow_policy, const worker_warmup_callback& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms, const async_queue_type queue_type, const async_wait_strategy wait_strategy, size_t worker_threads):
+    _next_worker(0),
+    _drop_watermark(queue_size * SPDLOG_ASYNC_DROP_WATERMARK / 100),
+    _worker_failed(false),
+    _dropped(0),
+    _total_block_ns(0),
+    _max_block_ns(0),
+    _flush_tokens(0),
     _overflow_policy(overflow_policy),
     _worker_warmup_cb(worker_warmup_cb),
     _flush_interval_ms(flush_interval_ms),
-    _worker_thread(&async_log_helper::worker_loop, this)
-{}
+    _wait_strategy(wait_strategy)
+{
+    if (worker_threads == 0)
+        throw spdlog_ex("async logger: worker_threads must be at least 1");
+
+    for (size_t i = 0; i < worker_threads; ++i)
+    {
+        std::unique_ptr<worker> w(new worker);
+        w->index = i;
+        if (queue_type == async_queue_type::mpmc)
+            w->q.reset(new q_type(queue_size));
+        else
+            w->spsc_q.reset(new spsc_q_type(queue_size, queue_type == async_queue_type::spsc_timestamp));
+        w->parked = false;
+        w->has_next_msg = false;
+        w->failed = false;
+        w->high_water_mark = 0;
+        _workers.push_back(std::move(w));
+    }
 
-// Send to the worker thread termination message(level=off)
-// and wait for it to finish gracefully
+    for (auto& w : _workers)
+        w->thread = std::thread(&async_log_helper::worker_loop, this, std::ref(*w));
+}
+
+// Send to the worker threads termination message(level=off)
+// and wait for them to finish gracefully
 inline spdlog::details::async_log_helper::~async_log_helper()
 {
 
     try
     {
-        log(log_msg(level::off));
-        _worker_thread.join();
+        for (auto& w : _workers)
+            push_msg(*w, async_msg(async_msg_type::terminate, nullptr, nullptr));
+        for (auto& w : _workers)
+            w->thread.join();
     }
     catch (...) //Dont crash if thread not joinable
     {}
 }
 
 
-//Try to push and block until succeeded
-inline void spdlog::details::async_log_helper::log(const details::log_msg& msg)
+inline spdlog::details::async_log_route* spdlog::details::async_log_helper::add_route(const std::string& logger_name, formatter_ptr formatter, const std::vector<sink_ptr>& sinks)
+{
+    std::unique_ptr<async_log_route> route(new async_log_route);
+    route->logger_name = &logger_name;
+    route->formatter = formatter;
+    route->worker_sinks.resize(_workers.size());
+    route->counts.reset(new async_log_route::message_counter[_workers.size()]);
+    route->drops.reset(new async_log_route::drop_counter[_workers.size()]);
+    for (size_t i = 0; i < _workers.size(); ++i)
+    {
+        route->counts[i].enqueued = 0;
+        route->counts[i].done = 0;
+        route->drops[i].count = 0;
+        route->drops[i].first_drop_time = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(_routes_mutex);
+    for (auto& s : sinks)
+    {
+        auto found = _sink_workers.find(s.get());
+        if (found == _sink_workers.end())
+            found = _sink_workers.emplace(s.get(), _next_worker++ % _workers.size()).first;
+        route->worker_sinks[found->second].push_back(s);
+    }
+    _routes.push_back(std::move(route));
+    return _routes.back().get();
+}
+
+inline void spdlog::details::async_log_helper::remove_route(async_log_route* route)
+{
+    // discarded messages of the route are reported by the flush, not left for a later batch which will never come
+    if (has_drops(*route))
+        flush_route(*route);
+
+    // wait for every live worker thread to log the route's messages.
+    // the messages left in the queue of a dead worker are never dereferenced.
+    auto last_op_time = details::os::now();
+    for (auto& w : _workers)
+    {
+        auto& counts = route->counts[w->index];
+        while (counts.done.load(std::memory_order_acquire) != counts.enqueued.load(std::memory_order_acquire) && !w->failed.load(std::memory_order_acquire))
+            sleep_or_yield(details::os::now(), last_op_time);
+    }
+
+    std::lock_guard<std::mutex> lock(_routes_mutex);
+    auto found = std::find_if(_routes.begin(), _routes.end(), [route](const std::unique_ptr<async_log_route>& r)
+    {
+        return r.get() == route;
+    });
+    if (found == _routes.end())
+        return;
+    std::unique_ptr<async_log_route> removed = std::move(*found);
+    _routes.erase(found);
+
+    // forget the worker of sinks no longer used by any route
+    for (auto& worker_sinks : removed->worker_sinks)
+    {
+        for (auto& s : worker_sinks)
+        {
+            bool in_use = std::any_of(_routes.begin(), _routes.end(), [&s](const std::unique_ptr<async_log_route>& r)
+            {
+                for (auto& ws : r->worker_sinks)
+                    if (std::find(ws.begin(), ws.end(), s) != ws.end())
+                        return true;
+                return false;
+            });
+            if (!in_use)
+                _sink_workers.erase(s.get());
+        }
+    }
+}
+
+// Pass the message to every worker serving sinks of the route
+inline void spdlog::details::async_log_helper::log(async_log_route& route, const details::log_msg& msg)
+{
+    throw_if_bad_worker();
+    for (auto& w : _workers)
+    {
+        if (route.worker_sinks[w->index].empty())
+            continue;
+        route.counts[w->index].enqueued.fetch_add(1, std::memory_order_relaxed);
+        if (!push_msg(*w, async_msg(msg, &route)))
+            route.counts[w->index].done.fetch_add(1, std::memory_order_release);
+    }
+}
+
+inline bool spdlog::details::async_log_helper::discard_if_full(const async_msg& msg) const
+{
+    // control tokens are never discarded
+    if (msg.msg_type != async_msg_type::log)
+        return false;
+
+    switch (_overflow_policy)
+    {
+    case async_overflow_policy::discard_log_msg:
+        return true;
+    case async_overflow_policy::discard_by_level:
+        return msg.level < level::err;
+    default:
+        return false;
+    }
+}
+
+inline void spdlog::details::async_log_helper::record_drop(worker& w, const async_msg& msg)
+{
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    // only discard_by_level reports the dropped messages in the log
+    if (!msg.route || _overflow_policy != async_overflow_policy::discard_by_level)
+        return;
+    auto& drops = msg.route->drops[w.index];
+    if (drops.count.fetch_add(1, std::memory_order_relaxed) == 0)
+        drops.first_drop_time.store(msg.time.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+inline void spdlog::details::async_log_helper::flush(async_log_route& route)
 {
     throw_if_bad_worker();
-    async_msg new_msg(msg);
-    if (!_q.enqueue(std::move(new_msg)) && _overflow_policy != async_overflow_policy::discard_log_msg)
+    flush_route(route);
+    throw_if_bad_worker();
+}
+
+inline void spdlog::details::async_log_helper::flush_route(async_log_route& route)
+{
+    flush_barrier barrier;
+    barrier.reached.resize(_workers.size(), true);
+    barrier.targets.resize(_workers.size(), 0);
+    for (auto& w : _workers)
+    {
+        if (!route.worker_sinks[w->index].empty())
+        {
+            barrier.reached[w->index] = false;
+            barrier.targets[w->index] = route.counts[w->index].enqueued.load(std::memory_order_acquire);
+        }
+    }
+
+    for (auto& w : _workers)
+    {
+        if (!barrier.reached[w->index])
+        {
+            push_msg(*w, async_msg(async_msg_type::flush, &route, &barrier));
+            _flush_tokens.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // wait for each worker thread to reach its token, unless it died (then it never touches the barrier)
+    auto done = [this, &barrier]()
+    {
+        for (auto& w : _workers)
+            if (!barrier.reached[w->index] && !w->failed.load(std::memory_order_acquire))
+                return false;
+        return true;
+    };
+    std::unique_lock<std::mutex> lock(barrier.mutex);
+    while (!done())
+        barrier.cv.wait_for(lock, std::chrono::milliseconds(100));
+}
+
+//Try to push and block until succeeded
+inline bool spdlog::details::async_log_helper::push_msg(worker& w, async_msg&& new_msg)
+{
+    // under discard_by_level, keep the room above the watermark for the more important messages
+    if (_overflow_policy == async_overflow_policy::discard_by_level && new_msg.msg_type == async_msg_type::log && new_msg.level <= level::info &&
+            producer_queue_size(w) >= _drop_watermark)
     {
+        record_drop(w, new_msg);
+        return false;
+    }
+
+    bool enqueued = enqueue_msg(w, std::move(new_msg));
+    if (!enqueued && discard_if_full(new_msg))
+    {
+        record_drop(w, new_msg);
+    }
+    else if (!enqueued)
+    {
+        auto block_start = clock::now();
         auto last_op_time = details::os::now();
         auto now = last_op_time;
         do
@@ -216,71 +730,255 @@ inline void spdlog::details::async_log_helper::log(const details::log_msg& msg)
             now = details::os::now();
             sleep_or_yield(now, last_op_time);
         }
-        while (!_q.enqueue(std::move(new_msg)));
+        while (!enqueue_msg(w, std::move(new_msg)));
+        enqueued = true;
+
+        uint64_t block_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - block_start).count();
+        _total_block_ns.fetch_add(block_ns, std::memory_order_relaxed);
+        uint64_t max_ns = _max_block_ns.load(std::memory_order_relaxed);
+        while (block_ns > max_ns && !_max_block_ns.compare_exchange_weak(max_ns, block_ns, std::memory_order_relaxed));
     }
 
+    if (_wait_strategy == async_wait_strategy::blocking)
+        notify_worker(w);
+    return enqueued;
 }
 
-inline void spdlog::details::async_log_helper::worker_loop()
+inline void spdlog::details::async_log_helper::worker_loop(worker& w)
 {
     try
     {
-        if (_worker_warmup_cb) _worker_warmup_cb();
+        if (_worker_warmup_cb) _worker_warmup_cb(w.index);
         auto last_pop = details::os::now();
         auto last_flush = last_pop;
-        while(process_next_msg(last_pop, last_flush));
+        // reused for all messages, so its buffers keep their capacity
+        log_batch batch(SPDLOG_ASYNC_BATCH_SIZE);
+        while(process_next_msgs(w, batch, last_pop, last_flush));
     }
     catch (const std::exception& ex)
     {
-        _last_workerthread_ex = std::make_shared<spdlog_ex>(std::string("async_logger worker thread exception: ") + ex.what());
+        set_worker_failed(w, std::string("async_logger worker thread exception: ") + ex.what());
     }
     catch (...)
     {
-        _last_workerthread_ex = std::make_shared<spdlog_ex>("async_logger worker thread exception");
+        set_worker_failed(w, "async_logger worker thread exception");
     }
 }
 
-// process next message in the queue
-// return true if this thread should still be active (no msg with level::off was received)
-inline bool spdlog::details::async_log_helper::process_next_msg(log_clock::time_point& last_pop, log_clock::time_point& last_flush)
+inline void spdlog::details::async_log_helper::set_worker_failed(worker& w, const std::string& what)
 {
+    {
+        std::lock_guard<std::mutex> lock(_workerthread_ex_mutex);
+        _last_workerthread_ex = std::make_shared<spdlog_ex>(what);
+    }
+    _worker_failed.store(true, std::memory_order_release);
+    w.failed.store(true, std::memory_order_release);
+}
 
-    async_msg incoming_async_msg;
-    log_msg incoming_log_msg;
+// process next messages in the queue
+// return true if this thread should still be active (no terminate msg was received)
+inline bool spdlog::details::async_log_helper::process_next_msgs(worker& w, log_batch& batch, log_clock::time_point& last_pop, log_clock::time_point& last_flush)
+{
+    // messages the waiting flushes depend on may have been logged (or discarded by their producer) meanwhile
+    if (!w.waiting_flushes.empty())
+        complete_waiting_flushes(w);
 
-    if (_q.dequeue(incoming_async_msg))
+    bool got_msg = w.has_next_msg || dequeue_msg(w, w.next_msg);
+    if (!got_msg) //empty queue
+    {
+        auto now = details::os::now();
+        handle_flush_interval(w, now, last_flush);
+        got_msg = wait_for_msg(w, w.next_msg, now, last_pop, last_flush);
+    }
+    w.has_next_msg = false;
+
+    if (got_msg)
     {
         last_pop = details::os::now();
 
-        if(incoming_async_msg.level == level::off)
+        // sample the queue depth (including the message just dequeued)
+        size_t depth = queue_size(w) + 1;
+        if (depth > w.high_water_mark.load(std::memory_order_relaxed))
+            w.high_water_mark.store(depth, std::memory_order_relaxed);
+
+        if (w.next_msg.msg_type == async_msg_type::terminate)
+        {
+            // with per producer queues, messages of other threads might still be waiting
+            while (w.has_next_msg || dequeue_msg(w, w.next_msg))
+            {
+                w.has_next_msg = false;
+                if (w.next_msg.msg_type != async_msg_type::terminate)
+                    process_msg(w, batch);
+            }
+            complete_waiting_flushes(w, true);
+
+            // report the messages discarded since the last batch of each route
+            std::lock_guard<std::mutex> lock(_routes_mutex);
+            for (auto& route : _routes)
+                log_drops(w, *route);
             return false;
+        }
+        process_msg(w, batch);
+    }
+    return true;
+}
+
+inline void spdlog::details::async_log_helper::process_msg(worker& w, log_batch& batch)
+{
+    if (w.next_msg.msg_type == async_msg_type::flush)
+        return handle_flush_token(w, w.next_msg);
 
-        incoming_async_msg.fill_log_msg(incoming_log_msg);
-        _formatter->format(incoming_log_msg);
-        for (auto &s : _sinks)
-            s->log(incoming_log_msg);
+    auto& route = fill_batch(w, batch);
+    log_to_sinks(w, route, batch);
+}
+
+inline spdlog::details::async_log_route& spdlog::details::async_log_helper::fill_batch(worker& w, log_batch& batch)
+{
+    batch.clear();
+    auto route = w.next_msg.route;
+    do
+    {
+        w.next_msg.fill_log_msg(batch.next());
+        batch.append();
+
+        if (batch.full() || !dequeue_msg(w, w.next_msg))
+            return *route;
     }
-    else //empty queue
+    while (w.next_msg.route == route && w.next_msg.msg_type == async_msg_type::log);
+
+    // belongs to the next batch
+    w.has_next_msg = true;
+    return *route;
+}
+
+inline void spdlog::details::async_log_helper::handle_flush_token(worker& w, async_msg& token)
+{
+    if (token.route->counts[w.index].done.load(std::memory_order_acquire) < token.barrier->targets[w.index])
+        w.waiting_flushes.push_back(std::move(token));
+    else
+        complete_flush(w, token);
+}
+
+inline void spdlog::details::async_log_helper::complete_waiting_flushes(worker& w, bool all)
+{
+    for (auto it = w.waiting_flushes.begin(); it != w.waiting_flushes.end();)
     {
-        auto now = details::os::now();
-        handle_flush_interval(now, last_flush);
-        sleep_or_yield(now, last_pop);
+        if (all || it->route->counts[w.index].done.load(std::memory_order_acquire) >= it->barrier->targets[w.index])
+        {
+            complete_flush(w, *it);
+            it = w.waiting_flushes.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+inline void spdlog::details::async_log_helper::complete_flush(worker& w, async_msg& token)
+{
+    log_drops(w, *token.route);
+    for (auto &s : token.route->worker_sinks[w.index])
+        s->flush();
+
+    // notify under the lock: the waiting thread destroys the barrier as soon as all workers reached it
+    std::lock_guard<std::mutex> lock(token.barrier->mutex);
+    token.barrier->reached[w.index] = true;
+    token.barrier->cv.notify_all();
+}
+
+inline void spdlog::details::async_log_helper::log_to_sinks(worker& w, async_log_route& route, log_batch& batch)
+{
+    auto& sinks = route.worker_sinks[w.index];
+    auto logger_formatter = route.formatter.get();
+
+    // messages of the call sites' format strings are rendered only if some sink needs their text
+    bool render = std::any_of(sinks.begin(), sinks.end(), [](const sink_ptr& s)
+    {
+        return s->needs_formatted() || !s->accepts_deferred();
+    });
+    if (render)
+    {
+        for (size_t i = 0; i < batch.size(); ++i)
+            async_msg::render_deferred(batch.msgs[i]);
+    }
+    for (size_t i = 0; i < sinks.size(); ++i)
+    {
+        if (!first_of_formatter_group(sinks, i, logger_formatter))
+            continue;
+
+        auto group_formatter = sink_formatter(*sinks[i], logger_formatter);
+        bool formatted = false;
+        for (size_t j = i; j < sinks.size(); ++j)
+        {
+            auto& sink = sinks[j];
+            if (sink_formatter(*sink, logger_formatter) != group_formatter)
+                continue;
+            if (!formatted && sink->needs_formatted())
+            {
+                format_batch(*group_formatter, batch);
+                formatted = true;
+            }
+            sink->log_batch(batch);
+        }
+    }
+    // the queue has room again - report the messages discarded meanwhile
+    log_drops(w, route);
+    route.counts[w.index].done.fetch_add(batch.size(), std::memory_order_release);
+}
+
+inline void spdlog::details::async_log_helper::log_drops(worker& w, async_log_route& route)
+{
+    auto& drops = route.drops[w.index];
+    if (!drops.count.load(std::memory_order_relaxed))
+        return;
+    auto count = drops.count.exchange(0, std::memory_order_relaxed);
+    auto since = log_clock::time_point(log_clock::duration(drops.first_drop_time.exchange(0, std::memory_order_relaxed)));
+
+    log_msg msg(level::warn);
+#ifndef SPDLOG_NO_NAME
+    msg.logger_name = *route.logger_name;
+#endif
+    msg.time = details::os::now();
+    msg.thread_id = details::os::thread_id();
+    std::tm tm = details::os::localtime(log_clock::to_time_t(since));
+    msg.raw.write("dropped {} messages since {:04d}-{:02d}-{:02d} {:02d}:{:02d}:{:02d}", count,
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    details::log_to_sinks(msg, route.worker_sinks[w.index], route.formatter.get());
+}
+
+inline bool spdlog::details::async_log_helper::has_drops(const async_log_route& route) const
+{
+    for (size_t i = 0; i < _workers.size(); ++i)
+        if (route.drops[i].count.load(std::memory_order_relaxed))
+            return true;
+    return false;
+}
+
+inline void spdlog::details::async_log_helper::format_batch(formatter& batch_formatter, log_batch& batch)
+{
+    batch.formatted.clear();
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        log_msg& msg = batch.msgs[i];
+        msg.formatted.clear();
+        batch_formatter.format(msg);
+        batch.formatted << fmt::StringRef(msg.formatted.data(), msg.formatted.size());
     }
-    return true;
 }
 
-inline void spdlog::details::async_log_helper::handle_flush_interval(log_clock::time_point& now, log_clock::time_point& last_flush)
+inline void spdlog::details::async_log_helper::handle_flush_interval(worker& w, log_clock::time_point& now, log_clock::time_point& last_flush)
 {
     if (_flush_interval_ms != std::chrono::milliseconds::zero() && now - last_flush >= _flush_interval_ms)
     {
-        for (auto &s : _sinks)
-            s->flush();
+        std::lock_guard<std::mutex> lock(_routes_mutex);
+        for (auto &route : _routes)
+            for (auto &s : route->worker_sinks[w.index])
+                s->flush();
         now = last_flush = details::os::now();
     }
 }
-inline void spdlog::details::async_log_helper::set_formatter(formatter_ptr msg_formatter)
+inline void spdlog::details::async_log_helper::set_formatter(async_log_route& route, formatter_ptr msg_formatter)
 {
-    _formatter = msg_formatter;
+    route.formatter = msg_formatter;
 }
 
 
@@ -308,14 +1006,106 @@ inline void spdlog::details::async_log_helper::sleep_or_yield(const spdlog::log_
     return sleep_for(milliseconds(100));
 }
 
+inline bool spdlog::details::async_log_helper::wait_for_msg(worker& w, async_msg& msg, const log_clock::time_point& now, const log_clock::time_point& last_pop, const log_clock::time_point& last_flush)
+{
+    switch (_wait_strategy)
+    {
+    case async_wait_strategy::busy_spin:
+        return false;
+
+    case async_wait_strategy::backoff:
+        sleep_or_yield(now, last_pop);
+        return false;
+
+    case async_wait_strategy::blocking:
+    {
+        std::unique_lock<std::mutex> lock(w.wait_mutex);
+        w.parked.store(true, std::memory_order_relaxed);
+        // pairs with the fence in notify_worker(): either the producer sees the parked flag,
+        // or this thread sees its message in the queue
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (dequeue_msg(w, msg))
+        {
+            w.parked.store(false, std::memory_order_relaxed);
+            return true;
+        }
+        // wake up in time for the next periodic flush
+        if (_flush_interval_ms != std::chrono::milliseconds::zero())
+            w.wait_cv.wait_for(lock, _flush_interval_ms - (now - last_flush));
+        else
+            w.wait_cv.wait(lock);
+        w.parked.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    }
+    return false;
+}
+
+inline void spdlog::details::async_log_helper::notify_worker(worker& w)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (w.parked.load(std::memory_order_relaxed))
+    {
+        // taking the mutex ensures the worker is already waiting on the cv
+        std::lock_guard<std::mutex> lock(w.wait_mutex);
+        w.wait_cv.notify_one();
+    }
+}
+
+inline bool spdlog::details::async_log_helper::enqueue_msg(worker& w, async_msg&& msg)
+{
+    return w.q ? w.q->enqueue(std::move(msg)) : w.spsc_q->enqueue(std::move(msg));
+}
+
+inline bool spdlog::details::async_log_helper::dequeue_msg(worker& w, async_msg& msg)
+{
+    if (!(w.q ? w.q->dequeue(msg) : w.spsc_q->dequeue(msg)))
+        return false;
+    return true;
+}
+
+// worker thread only. does not take the mutex of the per producer queues
+inline size_t spdlog::details::async_log_helper::queue_size(worker& w)
+{
+    return w.q ? w.q->approx_size() : w.spsc_q->consumer_approx_size();
+}
+
+// depth of the queue the calling producer thread enqueues to
+inline size_t spdlog::details::async_log_helper::producer_queue_size(worker& w)
+{
+    return w.q ? w.q->approx_size() : w.spsc_q->producer_approx_size();
+}
+
+inline spdlog::async_stats spdlog::details::async_log_helper::stats()
+{
+    async_stats stats;
+    for (auto& w : _workers)
+    {
+        stats.queue_depth += w->q ? w->q->approx_size() : w->spsc_q->approx_size();
+        stats.high_water_mark += w->high_water_mark.load(std::memory_order_relaxed);
+        stats.enqueued += w->q ? w->q->enqueued_count() : w->spsc_q->enqueued_count();
+    }
+    // not counting the flush tokens
+    stats.enqueued -= (std::min)(stats.enqueued, _flush_tokens.load(std::memory_order_relaxed));
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.total_block_time = std::chrono::nanoseconds(_total_block_ns.load(std::memory_order_relaxed));
+    stats.max_block_time = std::chrono::nanoseconds(_max_block_ns.load(std::memory_order_relaxed));
+    return stats;
+}
+
 // throw if the worker thread threw an exception or not active
 inline void spdlog::details::async_log_helper::throw_if_bad_worker()
 {
-    if (_last_workerthread_ex)
+    if (!_worker_failed.load(std::memory_order_acquire))
+        return;
+
+    std::shared_ptr<spdlog_ex> ex;
     {
-        auto ex = std::move(_last_workerthread_ex);
-        throw *ex;
+        std::lock_guard<std::mutex> lock(_workerthread_ex_mutex);
+        ex = std::move(_last_workerthread_ex);
     }
+    if (ex)
+        throw *ex;
 }
 
 
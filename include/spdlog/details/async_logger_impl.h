@@ -25,11 +25,14 @@
 #pragma once
 
 
+#include <algorithm>
+#include <iterator>
+
 #include "./async_log_helper.h"
 
 //
 // Async Logger implementation
-// Use single async_sink (queue) to perform the logging in a worker thread
+// Use an async_log_helper (queue and worker threads), owned or shared with other loggers, to perform the logging
 //
 
 
@@ -39,44 +42,81 @@ inline spdlog::async_logger::async_logger(const std::string& logger_name,
         const It& end,
         size_t queue_size,
         const  async_overflow_policy overflow_policy,
-        const std::function<void()>& worker_warmup_cb,
-        const std::chrono::milliseconds& flush_interval_ms) :
+        const worker_warmup_callback& worker_warmup_cb,
+        const std::chrono::milliseconds& flush_interval_ms,
+        const async_queue_type queue_type,
+        const async_wait_strategy wait_strategy,
+        size_t worker_threads) :
+    // no point in more worker threads than sinks
+    async_logger(logger_name, begin, end, std::make_shared<details::async_log_helper>(queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, queue_type, wait_strategy,
+                 (std::min)(worker_threads, (std::max)(static_cast<size_t>(std::distance(begin, end)), static_cast<size_t>(1))))) {}
+
+template<class It>
+inline spdlog::async_logger::async_logger(const std::string& logger_name,
+        const It& begin,
+        const It& end,
+        std::shared_ptr<details::async_log_helper> async_log_helper) :
     logger(logger_name, begin, end),
-    _async_log_helper(new details::async_log_helper(_formatter, _sinks, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms))
+    _async_log_helper(async_log_helper),
+    _route(_async_log_helper->add_route(_name, _formatter, _sinks))
 {
+#ifdef SPDLOG_ASYNC_DEFERRED_FORMAT
+    _deferred_format = true;
+#endif
 }
 
 inline spdlog::async_logger::async_logger(const std::string& logger_name,
         sinks_init_list sinks,
         size_t queue_size,
         const  async_overflow_policy overflow_policy,
-        const std::function<void()>& worker_warmup_cb,
-        const std::chrono::milliseconds& flush_interval_ms) :
-    async_logger(logger_name, sinks.begin(), sinks.end(), queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms) {}
+        const worker_warmup_callback& worker_warmup_cb,
+        const std::chrono::milliseconds& flush_interval_ms,
+        const async_queue_type queue_type,
+        const async_wait_strategy wait_strategy,
+        size_t worker_threads) :
+    async_logger(logger_name, sinks.begin(), sinks.end(), queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, queue_type, wait_strategy, worker_threads) {}
 
 inline spdlog::async_logger::async_logger(const std::string& logger_name,
         sink_ptr single_sink,
         size_t queue_size,
         const  async_overflow_policy overflow_policy,
-        const std::function<void()>& worker_warmup_cb,
-        const std::chrono::milliseconds& flush_interval_ms) :
-    async_logger(logger_name, { single_sink }, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms) {}
+        const worker_warmup_callback& worker_warmup_cb,
+        const std::chrono::milliseconds& flush_interval_ms,
+        const async_queue_type queue_type,
+        const async_wait_strategy wait_strategy,
+        size_t worker_threads) :
+    async_logger(logger_name, { single_sink }, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, queue_type, wait_strategy, worker_threads) {}
+
+inline spdlog::async_logger::~async_logger()
+{
+    _async_log_helper->remove_route(_route);
+}
+
+inline spdlog::async_stats spdlog::async_logger::stats() const
+{
+    return _async_log_helper->stats();
+}
 
 
 inline void spdlog::async_logger::_set_formatter(spdlog::formatter_ptr msg_formatter)
 {
     _formatter = msg_formatter;
-    _async_log_helper->set_formatter(_formatter);
+    _async_log_helper->set_formatter(*_route, _formatter);
 }
 
 inline void spdlog::async_logger::_set_pattern(const std::string& pattern)
 {
     _formatter = std::make_shared<pattern_formatter>(pattern);
-    _async_log_helper->set_formatter(_formatter);
+    _async_log_helper->set_formatter(*_route, _formatter);
 }
 
 
 inline void spdlog::async_logger::_log_msg(details::log_msg& msg)
 {
-    _async_log_helper->log(msg);
+    _async_log_helper->log(*_route, msg);
+}
+
+inline void spdlog::async_logger::_flush()
+{
+    _async_log_helper->flush(*_route);
 }
@@ -0,0 +1,500 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#pragma once
+
+// Binary log format, written by binary_file_sink and read back by binary_log_reader (see tools/binlog_decode.cpp).
+//
+// Messages are stored without pattern formatting: each record holds the ids of its call site and logger name,
+// the level, the time, the thread id and the message text. The call sites (file, line, function, level, format string)
+// and logger names are written once per file session, as dictionary records preceding their first message.
+// Messages of a call site with deferred args (see SPDLOG_ASYNC_DEFERRED_FORMAT) are not even formatted:
+// their record holds the raw values of the args, formatted with the call site's format string by the decoder.
+// The decoder renders the messages back to text with any pattern_formatter pattern.
+//
+// Records start with a one byte tag. Numbers are in the byte order of the writer, checked by the decoder.
+// Strings are a uint32 length followed by the bytes.
+// Site and name ids are numbered 1, 2, 3... in each session, in the order of their dictionary records.
+//   'H' session header:  uint32 byte order mark, uint32 version. starts a file and each later session appended to it
+//   'S' call site:       uint32 id, uint8 level, uint32 line, string file, string function, string format
+//   'N' logger name:     uint32 id, string name
+//   'M' message:         uint32 site id (0 for none), uint32 name id, uint8 level, int64 time (ns since epoch),
+//                        uint64 thread id, string text
+//   'A' message args:    the fields of 'M' up to the thread id (with a site id), uint8 args count, and for each arg
+//                        uint8 type (fmt::internal::Value::Type) and its value: int32 for INT BOOL CHAR, uint32 for UINT,
+//                        int64 for LONG_LONG, uint64 for ULONG_LONG, double for DOUBLE (long doubles are stored as double)
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common.h"
+#include "./format.h"
+#include "./log_msg.h"
+#include "./os.h"
+
+namespace spdlog
+{
+namespace details
+{
+namespace binary_log
+{
+static const uint32_t byte_order_mark = 0x01020304;
+static const uint32_t version = 2;
+
+enum record_tag : char
+{
+    header_tag = 'H',
+    site_tag = 'S',
+    name_tag = 'N',
+    message_tag = 'M',
+    args_tag = 'A'
+};
+
+typedef fmt::internal::Value arg_value;
+
+// encodes messages, with the dictionary records they need, into an in memory buffer
+class writer
+{
+public:
+    writer() {}
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+
+    // start a new session: the header, and the dictionaries written again as needed
+    void write_header()
+    {
+        _site_ids.clear();
+        _sites_count = 0;
+        _names.clear();
+        put(header_tag);
+        put(byte_order_mark);
+        put(version);
+    }
+
+    void write(const log_msg& msg)
+    {
+        uint32_t site_id = msg.source ? site_id_of(*msg.source) : 0;
+        uint32_t name_id = name_id_of(msg.logger_name);
+
+        // only the args of the site's own format string can be formatted by the decoder
+        if (!msg.deferred.empty() && site_id && msg.deferred.format_str == msg.source->fmt)
+        {
+            put_message_fields(args_tag, site_id, name_id, msg);
+            put_args(msg.deferred);
+            return;
+        }
+
+        put_message_fields(message_tag, site_id, name_id, msg);
+        if (msg.deferred.empty())
+        {
+            put_str(fmt::StringRef(msg.raw.data(), msg.raw.size()));
+            return;
+        }
+        // formatting errors are logged as the text, as the async worker does
+        _rendered.clear();
+        try
+        {
+            msg.deferred.render(_rendered);
+        }
+        catch (const spdlog_ex& ex)
+        {
+            _rendered.clear();
+            _rendered << ex.what();
+        }
+        put_str(fmt::StringRef(_rendered.data(), _rendered.size()));
+    }
+
+    const char* data() const
+    {
+        return _buffer.data();
+    }
+
+    size_t size() const
+    {
+        return _buffer.size();
+    }
+
+    void clear()
+    {
+        _buffer.clear();
+    }
+
+private:
+    struct name_entry
+    {
+        const char* data; // where the logger keeps the name. checked against the name, as loggers may come and go
+        std::string name;
+        uint32_t id;
+    };
+
+    // the session's id of the call site, written to the dictionary on first use
+    uint32_t site_id_of(const source_loc& source)
+    {
+        auto process_id = source.id();
+        if (process_id < _site_ids.size() && _site_ids[process_id])
+            return _site_ids[process_id];
+
+        if (process_id >= _site_ids.size())
+            _site_ids.resize(process_id + 1);
+        uint32_t site_id = ++_sites_count;
+        _site_ids[process_id] = site_id;
+
+        put(site_tag);
+        put(site_id);
+        put(static_cast<uint8_t>(source.level));
+        put(static_cast<uint32_t>(source.line));
+        put_str(source.filename);
+        put_str(source.funcname);
+        put_str(source.fmt ? source.fmt : "");
+        return site_id;
+    }
+
+    uint32_t name_id_of(fmt::StringRef name)
+    {
+        for (auto& entry : _names)
+        {
+            if (entry.data == name.data() && entry.name.size() == name.size() &&
+                    std::memcmp(entry.name.data(), name.data(), name.size()) == 0)
+                return entry.id;
+        }
+
+        uint32_t id = static_cast<uint32_t>(_names.size() + 1);
+        _names.push_back(name_entry { name.data(), std::string(name.data(), name.size()), id });
+        put(name_tag);
+        put(id);
+        put_str(name);
+        return id;
+    }
+
+    void put_message_fields(record_tag tag, uint32_t site_id, uint32_t name_id, const log_msg& msg)
+    {
+        put(tag);
+        put(site_id);
+        put(name_id);
+        put(static_cast<uint8_t>(msg.level));
+        put(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count()));
+        put(static_cast<uint64_t>(msg.thread_id));
+    }
+
+    void put_args(const deferred_args& args)
+    {
+        uint8_t count = 0;
+        while (count < deferred_args::max_args && arg_type(args, count) != arg_value::NONE)
+            ++count;
+        put(count);
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            auto& value = args.values[i];
+            auto type = arg_type(args, i);
+            put(static_cast<uint8_t>(type == arg_value::LONG_DOUBLE ? arg_value::DOUBLE : type));
+            switch (type)
+            {
+            case arg_value::UINT:
+                put(static_cast<uint32_t>(value.uint_value));
+                break;
+            case arg_value::LONG_LONG:
+                put(static_cast<int64_t>(value.long_long_value));
+                break;
+            case arg_value::ULONG_LONG:
+                put(static_cast<uint64_t>(value.ulong_long_value));
+                break;
+            case arg_value::DOUBLE:
+                put(value.double_value);
+                break;
+            case arg_value::LONG_DOUBLE:
+                put(static_cast<double>(value.long_double_value));
+                break;
+            default: // INT, BOOL, CHAR
+                put(static_cast<int32_t>(value.int_value));
+                break;
+            }
+        }
+    }
+
+    static arg_value::Type arg_type(const deferred_args& args, unsigned index)
+    {
+        return static_cast<arg_value::Type>((args.types >> (index * 4)) & 0xf);
+    }
+
+    template<typename T>
+    void put(T value)
+    {
+        _buffer << fmt::StringRef(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_str(fmt::StringRef str)
+    {
+        put(static_cast<uint32_t>(str.size()));
+        _buffer << str;
+    }
+
+    fmt::MemoryWriter _buffer;
+    fmt::MemoryWriter _rendered;
+    std::vector<uint32_t> _site_ids; // by source_loc::id(), 0 if not written in this session
+    uint32_t _sites_count = 0;
+    std::vector<name_entry> _names;
+};
+
+// reads back the messages of a binary log file
+class reader
+{
+public:
+    explicit reader(const std::string& filename) :
+        _file(open(filename)),
+        _filename(filename),
+        _file_size(file_size(_file.get())),
+        _offset(0)
+    {
+        if (get<char>() != header_tag)
+            throw spdlog_ex("Not a binary log file: " + filename);
+        read_header();
+    }
+
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+
+    // read the next message into msg, its logger name and source location stay valid until the next call.
+    // returns false at the end of the file. throws spdlog_ex on a corrupted or truncated file
+    bool next(log_msg& msg)
+    {
+        for (;;)
+        {
+            if (_offset == _file_size)
+                return false;
+            switch (get<char>())
+            {
+
+            case header_tag:
+                read_header();
+                break;
+
+            case site_tag:
+                read_site();
+                break;
+
+            case name_tag:
+                new_id(_names.size());
+                _names.push_back(get_str());
+                break;
+
+            case message_tag:
+                read_message(msg);
+                return true;
+
+            case args_tag:
+                read_args(msg);
+                return true;
+
+            default:
+                throw spdlog_ex("Corrupted binary log file " + _filename);
+            }
+        }
+    }
+
+private:
+    typedef std::unique_ptr<std::FILE, int(*)(std::FILE*)> file_ptr;
+
+    static file_ptr open(const std::string& filename)
+    {
+        std::FILE* fd;
+        if (os::fopen_s(&fd, filename, "rb"))
+            throw spdlog_ex("Failed opening file " + filename + " for reading");
+        return file_ptr(fd, std::fclose);
+    }
+
+    static uint64_t file_size(std::FILE* fd)
+    {
+#ifdef _WIN32
+        _fseeki64(fd, 0, SEEK_END);
+        auto size = _ftelli64(fd);
+        _fseeki64(fd, 0, SEEK_SET);
+#else
+        fseeko(fd, 0, SEEK_END);
+        auto size = ftello(fd);
+        fseeko(fd, 0, SEEK_SET);
+#endif
+        return size > 0 ? static_cast<uint64_t>(size) : 0;
+    }
+
+    // a decoded call site. source points into the strings
+    struct site
+    {
+        std::string filename, funcname, fmt;
+        std::unique_ptr<source_loc> source;
+    };
+
+    void read_header()
+    {
+        if (get<uint32_t>() != byte_order_mark)
+            throw spdlog_ex("Binary log file " + _filename + " was written with another byte order");
+        if (get<uint32_t>() != version)
+            throw spdlog_ex("Unsupported binary log file version in " + _filename);
+        // id 0 stands for none
+        _sites.clear();
+        _sites.resize(1);
+        _names.clear();
+        _names.resize(1);
+    }
+
+    // read the id of a new dictionary entry, which comes right after the ids read so far.
+    // checked before allocating, the id of a corrupted record can be anything
+    uint32_t new_id(size_t entries)
+    {
+        auto id = get<uint32_t>();
+        if (id != entries)
+            throw spdlog_ex("Corrupted binary log file " + _filename);
+        return id;
+    }
+
+    void read_site()
+    {
+        auto id = new_id(_sites.size());
+        _sites.resize(id + 1);
+        auto& s = _sites[id];
+        auto lvl = static_cast<level::level_enum>(get<uint8_t>());
+        auto line = static_cast<int>(get<uint32_t>());
+        s.filename = get_str();
+        s.funcname = get_str();
+        s.fmt = get_str();
+        s.source.reset(new source_loc { s.filename.c_str(), line, s.funcname.c_str(), lvl, s.fmt.c_str(), { id } });
+    }
+
+    void read_message(log_msg& msg)
+    {
+        read_message_fields(msg);
+        _text = get_str();
+        msg.raw << _text;
+    }
+
+    // the args are formatted with the site's format string. formatting errors are logged as the text, as they were
+    // by the async worker
+    void read_args(log_msg& msg)
+    {
+        read_message_fields(msg);
+        if (!msg.source)
+            throw spdlog_ex("Corrupted binary log file " + _filename);
+
+        deferred_args args;
+        auto count = get<uint8_t>();
+        if (count > deferred_args::max_args)
+            throw spdlog_ex("Corrupted binary log file " + _filename);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            auto type = static_cast<arg_value::Type>(get<uint8_t>());
+            auto& value = args.values[i];
+            switch (type)
+            {
+            case arg_value::INT:
+            case arg_value::BOOL:
+            case arg_value::CHAR:
+                value.int_value = get<int32_t>();
+                break;
+            case arg_value::UINT:
+                value.uint_value = get<uint32_t>();
+                break;
+            case arg_value::LONG_LONG:
+                value.long_long_value = get<int64_t>();
+                break;
+            case arg_value::ULONG_LONG:
+                value.ulong_long_value = get<uint64_t>();
+                break;
+            case arg_value::DOUBLE:
+                value.double_value = get<double>();
+                break;
+            default: // only arithmetic args are written. others would be read as pointers
+                throw spdlog_ex("Corrupted binary log file " + _filename);
+            }
+            args.types |= static_cast<fmt::ULongLong>(type) << (i * 4);
+        }
+
+        args.format_str = msg.source->fmt;
+        try
+        {
+            args.render(msg.raw);
+        }
+        catch (const spdlog_ex& ex)
+        {
+            msg.raw.clear();
+            msg.raw << ex.what();
+        }
+    }
+
+    // the fields common to message records, up to the thread id
+    void read_message_fields(log_msg& msg)
+    {
+        auto site_id = get<uint32_t>();
+        auto name_id = get<uint32_t>();
+        msg.clear();
+        msg.level = static_cast<level::level_enum>(get<uint8_t>());
+        msg.time = log_clock::time_point(std::chrono::duration_cast<log_clock::duration>(std::chrono::nanoseconds(get<int64_t>())));
+        msg.thread_id = static_cast<size_t>(get<uint64_t>());
+
+        if (site_id >= _sites.size() || name_id >= _names.size())
+            throw spdlog_ex("Corrupted binary log file " + _filename);
+        msg.source = _sites[site_id].source.get();
+        msg.logger_name = _names[name_id];
+    }
+
+    template<typename T>
+    T get()
+    {
+        T value;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    std::string get_str()
+    {
+        auto size = get<uint32_t>();
+        // checked before allocating, the size of a corrupted string can be anything
+        if (size > _file_size - _offset)
+            throw spdlog_ex("Corrupted binary log file " + _filename);
+        std::string str(size, '\0');
+        if (!str.empty())
+            read(&str[0], str.size());
+        return str;
+    }
+
+    void read(void* data, size_t size)
+    {
+        if (std::fread(data, 1, size, _file.get()) != size)
+            throw spdlog_ex("Truncated binary log file " + _filename);
+        _offset += size;
+    }
+
+    file_ptr _file;
+    std::string _filename;
+    uint64_t _file_size;
+    uint64_t _offset;
+    std::vector<site> _sites;
+    std::vector<std::string> _names;
+    std::string _text;
+};
+}
+}
+}
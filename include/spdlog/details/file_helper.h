@@ -33,6 +33,7 @@
 #include <thread>
 #include <chrono>
 #include "os.h"
+#include "log_msg.h"
 
 
 
@@ -102,15 +103,23 @@ public:
 
     void write(const log_msg& msg)
     {
+        write(msg.formatted.data(), msg.formatted.size());
+    }
+
+    // write all messages of the batch with a single fwrite
+    void write(const log_batch& batch)
+    {
+        write(batch.formatted.data(), batch.formatted.size());
+    }
 
-        size_t size = msg.formatted.size();
-        auto data = msg.formatted.data();
+    // write raw bytes, e.g. the records of a binary log
+    void write(const char* data, size_t size)
+    {
         if (std::fwrite(data, 1, size, _fd) != size)
             throw spdlog_ex("Failed writing to file " + _filename);
 
         if (_force_flush)
             std::fflush(_fd);
-
     }
 
     const std::string& filename() const
@@ -353,7 +353,10 @@ public:
 namespace internal {
 // The number of characters to store in the MemoryBuffer object itself
 // to avoid dynamic memory allocation.
-enum { INLINE_BUFFER_SIZE = 500 };
+#ifndef FMT_INLINE_BUFFER_SIZE
+# define FMT_INLINE_BUFFER_SIZE 500
+#endif
+enum { INLINE_BUFFER_SIZE = FMT_INLINE_BUFFER_SIZE };
 
 #if _SECURE_SCL
 // Use checked iterator to avoid warnings on MSVC.
@@ -23,6 +23,7 @@
 /*************************************************************************/
 
 #pragma once
+#include <atomic>
 #include <type_traits>
 #include "../common.h"
 #include "../logger.h"
@@ -34,12 +35,114 @@ namespace spdlog
 {
 namespace details
 {
+
+// The log_msg of each thread, recycled by its line_loggers.
+// Keeps the buffers grown by long messages for the next ones, and keeps the (large) log_msg off the caller's stack.
+// A thread with more than one live line_logger at a time (e.g. logging from within a sink) gets heap allocated
+// log_msgs for the others.
+// A line_logger moved to another thread may release the log_msg there, even after its thread exited:
+// the thread's recycled_log_msg is heap allocated, and freed by whichever of the two comes last.
+struct recycled_log_msg
+{
+    // messages bigger than this don't keep their buffers, so a single huge message doesn't pin its memory forever
+    static const size_t max_retained_size = 64 * 1024;
+
+    enum state_type
+    {
+        free_state,
+        in_use_state,
+        orphaned_state // in use when its thread exited, freed by the release
+    };
+
+    log_msg msg;
+    // changed from free by the owner thread only
+    std::atomic<int> state { free_state };
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+    // visual studio 2013 supports thread local storage of POD types only
+    static recycled_log_msg* instance()
+    {
+        return nullptr;
+    }
+#else
+    // frees the thread's recycled_log_msg when the thread exits, unless it is in use
+    struct thread_owner
+    {
+        recycled_log_msg* recycled = new recycled_log_msg();
+
+        // objects destroyed after the thread's storage (e.g. globals of the main thread) may still log.
+        // they get heap allocated log_msgs
+        ~thread_owner()
+        {
+            destroyed() = true;
+            if (recycled->state.exchange(orphaned_state, std::memory_order_acq_rel) == free_state)
+                delete recycled;
+        }
+    };
+
+    // POD, so it outlives the destroyed thread_owner
+    static bool& destroyed()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    static recycled_log_msg* instance()
+    {
+        if (destroyed())
+            return nullptr;
+        static thread_local thread_owner owner;
+        return owner.recycled;
+    }
+#endif
+
+    // recycled is set to the instance the log_msg belongs to, null if heap allocated
+    static log_msg* acquire(level::level_enum msg_level, recycled_log_msg*& recycled)
+    {
+        recycled = instance();
+        if (!recycled || recycled->state.load(std::memory_order_acquire) != free_state)
+        {
+            recycled = nullptr;
+            return new log_msg(msg_level);
+        }
+
+        recycled->state.store(in_use_state, std::memory_order_relaxed);
+        recycled->msg.level = msg_level;
+        return &recycled->msg;
+    }
+
+    // possibly from another thread than the acquiring one
+    static void release(log_msg* msg, recycled_log_msg* recycled)
+    {
+        if (!recycled)
+        {
+            delete msg;
+            return;
+        }
+
+        if (msg->raw.size() + msg->formatted.size() > max_retained_size)
+            *msg = log_msg();
+        else
+            msg->clear();
+
+        // the owner thread can't be exiting meanwhile
+        if (recycled == instance())
+        {
+            recycled->state.store(free_state, std::memory_order_release);
+            return;
+        }
+        int expected = in_use_state;
+        if (!recycled->state.compare_exchange_strong(expected, free_state, std::memory_order_acq_rel))
+            delete recycled; // orphaned: its thread exited
+    }
+};
+
 class line_logger
 {
 public:
     line_logger(logger* callback_logger, level::level_enum msg_level, bool enabled):
         _callback_logger(callback_logger),
-        _log_msg(msg_level),
+        _log_msg(enabled ? recycled_log_msg::acquire(msg_level, _recycled) : nullptr),
         _enabled(enabled)
     {}
 
@@ -51,9 +154,12 @@ public:
 
     line_logger(line_logger&& other) :
         _callback_logger(other._callback_logger),
-        _log_msg(std::move(other._log_msg)),
+        _recycled(other._recycled),
+        _log_msg(other._log_msg),
         _enabled(other._enabled)
     {
+        other._recycled = nullptr;
+        other._log_msg = nullptr;
         other.disable();
     }
 
@@ -63,17 +169,19 @@ public:
         if (_enabled)
         {
 #ifndef SPDLOG_NO_NAME
-            _log_msg.logger_name = _callback_logger->name();
+            _log_msg->logger_name = _callback_logger->name();
 #endif
 #ifndef SPDLOG_NO_DATETIME
-            _log_msg.time = os::now();
+            _log_msg->time = os::now();
 #endif
 
 #ifndef SPDLOG_NO_THREAD_ID
-            _log_msg.thread_id = os::thread_id();
+            _log_msg->thread_id = os::thread_id();
 #endif
-            _callback_logger->_log_msg(_log_msg);
+            _callback_logger->_log_msg(*_log_msg);
         }
+        if (_log_msg)
+            recycled_log_msg::release(_log_msg, _recycled);
     }
 
     //
@@ -84,7 +192,7 @@ public:
     void write(const char* what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            _log_msg->raw << what;
     }
 
     template <typename... Args>
@@ -92,14 +200,7 @@ public:
     {
         if (!_enabled)
             return;
-        try
-        {
-            _log_msg.raw.write(fmt, args...);
-        }
-        catch (const fmt::FormatError& e)
-        {
-            throw spdlog_ex(fmt::format("formatting error while processing format string '{}': {}", fmt, e.what()));
-        }
+        _write(deferred_args::can_defer<Args...>(), fmt, args...);
     }
 
 
@@ -109,28 +210,28 @@ public:
     line_logger& operator<<(const char* what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(const std::string& what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(int what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(unsigned int what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
@@ -138,56 +239,56 @@ public:
     line_logger& operator<<(long what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(unsigned long what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(long long what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(unsigned long long what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(double what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(long double what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(float what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
     line_logger& operator<<(char what)
     {
         if (_enabled)
-            _log_msg.raw << what;
+            raw() << what;
         return *this;
     }
 
@@ -196,11 +297,18 @@ public:
     line_logger& operator<<(const T& what)
     {
         if (_enabled)
-            _log_msg.raw.write("{}", what);
+            raw().write("{}", what);
         return *this;
     }
 
 
+    // where the message is logged from. must outlive the message
+    void set_source(const source_loc* source)
+    {
+        if (_enabled)
+            _log_msg->source = source;
+    }
+
     void disable()
     {
         _enabled = false;
@@ -213,8 +321,39 @@ public:
 
 
 private:
+    // the callback logger may let arithmetic-only args be rendered later (by its async worker)
+    template <typename... Args>
+    void _write(std::true_type, const char* fmt, const Args&... args)
+    {
+        if (_callback_logger->_deferred_format)
+            _log_msg->deferred.capture(fmt, args...);
+        else
+            _write(std::false_type(), fmt, args...);
+    }
+
+    template <typename... Args>
+    void _write(std::false_type, const char* fmt, const Args&... args)
+    {
+        try
+        {
+            _log_msg->raw.write(fmt, args...);
+        }
+        catch (const fmt::FormatError& e)
+        {
+            throw spdlog_ex(fmt::format("formatting error while processing format string '{}': {}", fmt, e.what()));
+        }
+    }
+
+    // raw msg to append to. renders first any deferred args so the appends keep their order.
+    fmt::MemoryWriter& raw()
+    {
+        _log_msg->render_deferred();
+        return _log_msg->raw;
+    }
+
     logger* _callback_logger;
-    log_msg _log_msg;
+    recycled_log_msg* _recycled = nullptr; // where _log_msg comes from, null if heap allocated
+    log_msg* _log_msg; // null if disabled at construction
     bool _enabled;
 };
 } //Namespace details
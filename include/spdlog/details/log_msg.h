@@ -25,6 +25,8 @@
 #pragma once
 
 #include <thread>
+#include <type_traits>
+#include <vector>
 #include "../common.h"
 #include "./format.h"
 
@@ -32,12 +34,68 @@ namespace spdlog
 {
 namespace details
 {
+
+// Format string and a by-value copy of its arguments, to be rendered later (possibly by another thread).
+// Only arithmetic args can be deferred since their captured values do not point into the caller's memory.
+// The format string itself is kept by pointer, the async queue copies it (unless it is the call site's, see source_loc).
+struct deferred_args
+{
+    static const unsigned max_args = 8;
+
+    template<typename... Args>
+    struct can_defer;
+
+    const char* format_str = nullptr;
+    fmt::ULongLong types = 0;
+    fmt::internal::Value values[max_args];
+
+    bool empty() const
+    {
+        return format_str == nullptr;
+    }
+
+    template<typename... Args>
+    void capture(const char* fmt_str, const Args&... args)
+    {
+        static_assert(can_defer<Args...>::value, "deferred_args: only up to max_args arithmetic args can be deferred");
+        format_str = fmt_str;
+        types = fmt::internal::make_type(args...);
+        fmt::internal::store_args<char>(values, args...);
+    }
+
+    // render into the given writer. throws spdlog_ex on format errors
+    void render(fmt::MemoryWriter& w) const
+    {
+        try
+        {
+            w.write(format_str, fmt::ArgList(types, values));
+        }
+        catch (const fmt::FormatError& e)
+        {
+            throw spdlog_ex(fmt::format("formatting error while processing format string '{}': {}", format_str, e.what()));
+        }
+    }
+};
+
+template<>
+struct deferred_args::can_defer<> : std::true_type {};
+
+template<typename T, typename... Rest>
+struct deferred_args::can_defer<T, Rest...> : std::integral_constant < bool,
+        sizeof...(Rest) < deferred_args::max_args &&
+        std::is_arithmetic<T>::value &&
+        deferred_args::can_defer<Rest...>::value > {};
+
+
 struct log_msg
 {
-    log_msg() = default;
+    log_msg() : log_msg(level::off) {}
     log_msg(level::level_enum l):
-        logger_name(),
+        logger_name("", 0),
         level(l),
+        time(),
+        thread_id(0),
+        source(nullptr),
         raw(),
         formatted() {}
 
@@ -46,7 +104,9 @@ struct log_msg
         logger_name(other.logger_name),
         level(other.level),
         time(other.time),
-        thread_id(other.thread_id)
+        thread_id(other.thread_id),
+        source(other.source),
+        deferred(other.deferred)
     {
         if (other.raw.size())
             raw << fmt::BasicStringRef<char>(other.raw.data(), other.raw.size());
@@ -55,10 +115,12 @@ struct log_msg
     }
 
     log_msg(log_msg&& other) :
-        logger_name(std::move(other.logger_name)),
+        logger_name(other.logger_name),
         level(other.level),
         time(std::move(other.time)),
         thread_id(other.thread_id),
+        source(other.source),
+        deferred(other.deferred),
         raw(std::move(other.raw)),
         formatted(std::move(other.formatted))
     {
@@ -70,29 +132,109 @@ struct log_msg
         if (this == &other)
             return *this;
 
-        logger_name = std::move(other.logger_name);
+        logger_name = other.logger_name;
         level = other.level;
         time = std::move(other.time);
         thread_id = other.thread_id;
+        source = other.source;
+        deferred = other.deferred;
         raw = std::move(other.raw);
         formatted = std::move(other.formatted);
         other.clear();
         return *this;
     }
 
+    // render the deferred format args (if any) into raw
+    void render_deferred()
+    {
+        if (!deferred.empty())
+        {
+            deferred.render(raw);
+            deferred.format_str = nullptr;
+        }
+    }
+
     void clear()
     {
         level = level::off;
+        source = nullptr;
+        deferred.format_str = nullptr;
         raw.clear();
         formatted.clear();
     }
 
-    std::string logger_name;
+    // not owned - refers to the name of the logger, which outlives its messages
+    fmt::StringRef logger_name;
     level::level_enum level;
     log_clock::time_point time;
     size_t thread_id;
+    // not owned - static per call site. null if not logged by the SPDLOG_LOGGER_* macros
+    const source_loc* source;
+    deferred_args deferred;
     fmt::MemoryWriter raw;
     fmt::MemoryWriter formatted;
 };
+
+
+// Consecutive formatted messages, handed to the sinks at once by the async worker.
+// Besides each message's own formatted text, the texts of all messages are kept back to back in formatted,
+// so sinks can write the whole batch with a single call.
+struct log_batch
+{
+    explicit log_batch(size_t capacity):
+        msgs(capacity),
+        count(0),
+        formatted() {}
+
+    log_batch(const log_batch&) = delete;
+    log_batch& operator=(const log_batch&) = delete;
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    bool full() const
+    {
+        return count == msgs.size();
+    }
+
+    const log_msg* begin() const
+    {
+        return msgs.data();
+    }
+
+    const log_msg* end() const
+    {
+        return msgs.data() + count;
+    }
+
+    // next free message slot. once filled, it must be committed with append()
+    log_msg& next()
+    {
+        return msgs[count];
+    }
+
+    void append()
+    {
+        ++count;
+    }
+
+    void clear()
+    {
+        count = 0;
+        formatted.clear();
+    }
+
+    // the message objects are reused between batches, so their buffers keep their capacity
+    std::vector<log_msg> msgs;
+    size_t count;
+    fmt::MemoryWriter formatted;
+};
 }
 }
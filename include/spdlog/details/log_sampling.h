@@ -0,0 +1,122 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#pragma once
+
+// Per call site limits on the number of logged messages, used by the
+// SPDLOG_LOGGER_RATE_LIMITED / SPDLOG_LOGGER_SAMPLED macros (see spdlog.h).
+// Each call site owns a static limiter. A check costs a couple of relaxed atomic operations,
+// so a runaway log site cannot flood the sinks or the async queue.
+// The messages suppressed meanwhile are counted, and reported by the next message logged by the site.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "../common.h"
+#include "./os.h"
+
+namespace spdlog
+{
+namespace details
+{
+
+// counts the messages a limiter suppresses
+class suppression_counter
+{
+public:
+    SPDLOG_CONSTEXPR suppression_counter() : _suppressed(0) {}
+
+    suppression_counter(const suppression_counter&) = delete;
+    suppression_counter& operator=(const suppression_counter&) = delete;
+
+    // the number of messages suppressed since the last call
+    uint64_t take_suppressed()
+    {
+        if (!_suppressed.load(std::memory_order_relaxed))
+            return 0;
+        return _suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+protected:
+    bool count_if_suppressed(bool allowed)
+    {
+        if (!allowed)
+            _suppressed.fetch_add(1, std::memory_order_relaxed);
+        return allowed;
+    }
+
+private:
+    std::atomic<uint64_t> _suppressed;
+};
+
+// at most max_per_second messages in each (wall clock) second
+class rate_limiter : public suppression_counter
+{
+public:
+    explicit SPDLOG_CONSTEXPR rate_limiter(uint64_t max_per_second) :
+        _max_per_second(max_per_second),
+        _second(0),
+        _count(0) {}
+
+    bool allow()
+    {
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(os::now().time_since_epoch()).count();
+        auto second = _second.load(std::memory_order_relaxed);
+        // first message of a new second - restart the count. the thread winning the exchange resets it
+        if (now != second && _second.compare_exchange_strong(second, now, std::memory_order_relaxed))
+            _count.store(0, std::memory_order_relaxed);
+        return count_if_suppressed(_count.fetch_add(1, std::memory_order_relaxed) < _max_per_second);
+    }
+
+private:
+    const uint64_t _max_per_second;
+    std::atomic<int64_t> _second;
+    std::atomic<uint64_t> _count;
+};
+
+// the first messages, then one in every ones.
+// e.g. first = 0, every = 100 samples 1 in 100 messages; first = 10, every = 1000 logs the first 10, then every 1000th.
+class log_sampler : public suppression_counter
+{
+public:
+    SPDLOG_CONSTEXPR log_sampler(uint64_t first, uint64_t every) :
+        _first(first),
+        _every(every ? every : 1),
+        _count(0) {}
+
+    bool allow()
+    {
+        auto n = _count.fetch_add(1, std::memory_order_relaxed);
+        return count_if_suppressed(n < _first || (n - _first) % _every == 0);
+    }
+
+private:
+    const uint64_t _first;
+    const uint64_t _every;
+    std::atomic<uint64_t> _count;
+};
+
+}
+}
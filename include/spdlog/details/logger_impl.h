@@ -36,7 +36,8 @@ template<class It>
 inline spdlog::logger::logger(const std::string& logger_name, const It& begin, const It& end) :
     _name(logger_name),
     _sinks(begin, end),
-    _formatter(std::make_shared<pattern_formatter>("%+"))
+    _formatter(std::make_shared<pattern_formatter>("%+")),
+    _deferred_format(false)
 {
 
     // no support under vs2013 for member initialization for std::atomic
@@ -70,14 +71,16 @@ inline void spdlog::logger::set_pattern(const std::string& pattern)
 
 //
 // log only if given level>=logger's log level
+// a disabled call costs the level load and an empty line_logger (no log_msg, nothing written)
 //
 
 
 template <typename... Args>
 inline spdlog::details::line_logger spdlog::logger::_log_if_enabled(level::level_enum lvl, const char* fmt, const Args&... args)
 {
-    bool msg_enabled = should_log(lvl);
-    details::line_logger l(this, lvl, msg_enabled);
+    if (!should_log(lvl))
+        return details::line_logger(this, lvl, false);
+    details::line_logger l(this, lvl, true);
     l.write(fmt, args...);
     return l;
 }
@@ -90,8 +93,9 @@ inline spdlog::details::line_logger spdlog::logger::_log_if_enabled(level::level
 template<typename T>
 inline spdlog::details::line_logger spdlog::logger::_log_if_enabled(level::level_enum lvl, const T& msg)
 {
-    bool msg_enabled = should_log(lvl);
-    details::line_logger l(this, lvl, msg_enabled);
+    if (!should_log(lvl))
+        return details::line_logger(this, lvl, false);
+    details::line_logger l(this, lvl, true);
     l << msg;
     return l;
 }
@@ -272,6 +276,15 @@ inline spdlog::details::line_logger spdlog::logger::force_log(level::level_enum
     return l;
 }
 
+template <typename... Args>
+inline spdlog::details::line_logger spdlog::logger::force_log(const source_loc* source, level::level_enum lvl, const char* fmt, const Args&... args)
+{
+    details::line_logger l(this, lvl, true);
+    l.set_source(source);
+    l.write(fmt, args...);
+    return l;
+}
+
 //
 // name and level
 //
@@ -300,9 +313,7 @@ inline bool spdlog::logger::should_log(spdlog::level::level_enum msg_level) cons
 //
 inline void spdlog::logger::_log_msg(details::log_msg& msg)
 {
-    _formatter->format(msg);
-    for (auto &sink : _sinks)
-        sink->log(msg);
+    details::log_to_sinks(msg, _sinks, _formatter.get());
 }
 
 inline void spdlog::logger::_set_pattern(const std::string& pattern)
@@ -314,7 +325,13 @@ inline void spdlog::logger::_set_formatter(formatter_ptr msg_formatter)
     _formatter = msg_formatter;
 }
 
-inline void spdlog::logger::flush() {
+inline void spdlog::logger::flush()
+{
+    _flush();
+}
+
+inline void spdlog::logger::_flush()
+{
     for (auto& sink : _sinks)
         sink->flush();
 }
\ No newline at end of file
@@ -62,6 +62,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include <atomic>
+#include <algorithm>
 #include "../common.h"
 
 namespace spdlog
@@ -148,6 +149,22 @@ public:
         return true;
     }
 
+    // number of items in the queue. only a snapshot when used concurrently with enqueue/dequeue
+    size_t approx_size() const
+    {
+        size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+        if (enqueue_pos <= dequeue_pos)
+            return 0;
+        return (std::min)(enqueue_pos - dequeue_pos, buffer_mask_ + 1);
+    }
+
+    // number of items enqueued so far
+    size_t enqueued_count() const
+    {
+        return enqueue_pos_.load(std::memory_order_relaxed);
+    }
+
 private:
     struct cell_t
     {
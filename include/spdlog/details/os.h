@@ -40,12 +40,20 @@
 #elif __linux__
 #include <sys/syscall.h> //Use gettid() syscall under linux to get thread id
 #include <unistd.h>
+#include <pthread.h>
 #else
 #include <thread>
+#include <pthread.h>
 #endif
 
+#include <atomic>
+
 #include "../common.h"
 
+#ifdef SPDLOG_CLOCK_TSC
+#include "./tsc_clock.h"
+#endif
+
 namespace spdlog
 {
 namespace details
@@ -56,7 +64,10 @@ namespace os
 inline spdlog::log_clock::time_point now()
 {
 
-#if defined __linux__ && defined SPDLOG_CLOCK_COARSE
+#if defined SPDLOG_CLOCK_TSC
+    return tsc_clock::instance().now();
+
+#elif defined __linux__ && defined SPDLOG_CLOCK_COARSE
     timespec ts;
     ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
     return std::chrono::time_point<log_clock, typename log_clock::duration>(
@@ -176,9 +187,9 @@ inline int utc_minutes_offset(const std::tm& tm = details::os::localtime())
 #endif
 }
 
-//Return current thread id as size_t
+//Return current thread id as size_t, as reported by the os (not cached)
 //It exists because the std::this_thread::get_id() is much slower(espcially under VS 2013)
-inline size_t thread_id()
+inline size_t os_thread_id()
 {
 #ifdef _WIN32
     return  static_cast<size_t>(::GetCurrentThreadId());
@@ -190,6 +201,51 @@ inline size_t thread_id()
 
 }
 
+//Per thread cache of thread_id() - 0 until first queried
+inline size_t& cached_thread_id()
+{
+    static SPDLOG_THREAD_LOCAL size_t id;
+    return id;
+}
+
+#ifdef SPDLOG_LOGICAL_THREAD_ID
+//Next logical thread id (1, 2, 3..), in the order threads first log
+inline std::atomic<size_t>& next_logical_thread_id()
+{
+    static std::atomic<size_t> next_id { 1 };
+    return next_id;
+}
+#endif
+
+#ifndef _WIN32
+//The child of fork() runs in a new thread - forget the cached id of the forking thread
+inline void reset_thread_id_after_fork()
+{
+    cached_thread_id() = 0;
+}
+#endif
+
+//Return current thread id as size_t.
+//Cached per thread, since getting it under linux takes a system call.
+//With SPDLOG_LOGICAL_THREAD_ID defined, returns a small sequential index instead of the os thread id.
+inline size_t thread_id()
+{
+    auto& id = cached_thread_id();
+    if (id == 0)
+    {
+#ifndef _WIN32
+        static const int fork_handler_registered = ::pthread_atfork(nullptr, nullptr, reset_thread_id_after_fork);
+        (void)fork_handler_registered;
+#endif
+#ifdef SPDLOG_LOGICAL_THREAD_ID
+        id = next_logical_thread_id()++;
+#else
+        id = os_thread_id();
+#endif
+    }
+    return id;
+}
+
 } //os
 } //details
 } //spdlog
@@ -29,6 +29,9 @@
 #include <memory>
 #include <vector>
 #include <thread>
+#include <ctime>
+#include <cstring>
+#include <cstdlib>
 
 
 #include "../formatter.h"
@@ -39,423 +42,638 @@ namespace spdlog
 {
 namespace details
 {
-class flag_formatter
-{
-public:
-    virtual ~flag_formatter() {}
-    virtual void format(details::log_msg& msg, const std::tm& tm_time) = 0;
-};
 
-///////////////////////////////////////////////////////////////////////
-// name & level pattern appenders
-///////////////////////////////////////////////////////////////////////
-namespace
-{
-class name_formatter :public flag_formatter
+// localtime() with a per thread cache.
+// Messages of the same second reuse the cached std::tm, and a later second within the same minute only updates tm_sec,
+// so the actual localtime call (which takes the libc timezone lock) happens about once a minute per thread.
+inline const std::tm& cached_localtime(std::time_t t)
 {
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        msg.formatted << msg.logger_name;
-    }
-};
+    static SPDLOG_THREAD_LOCAL bool cache_valid;
+    static SPDLOG_THREAD_LOCAL std::time_t cached_time;
+    static SPDLOG_THREAD_LOCAL std::tm cached_tm;
+
+    if (cache_valid && t == cached_time)
+        return cached_tm;
+
+    if (cache_valid && t > cached_time && t - cached_time < 60 - cached_tm.tm_sec)
+        cached_tm.tm_sec += static_cast<int>(t - cached_time);
+    else
+        cached_tm = os::localtime(t);
+    cached_time = t;
+    cache_valid = true;
+    return cached_tm;
+}
+
+// "00" to "99" - lets write_padded emit two digits per division
+static const char digits2[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+//write v as exactly width digits, zero padded. returns the position after the last digit
+static char* write_padded(char* p, int v, size_t width)
+{
+    auto u = static_cast<unsigned int>(v);
+    auto q = p + width;
+    for (; q - p >= 2; u /= 100)
+    {
+        q -= 2;
+        std::memcpy(q, digits2 + (u % 100) * 2, 2);
+    }
+    if (q != p)
+        *p = static_cast<char>('0' + u % 10);
+    return p + width;
 }
 
-// log level appender
-class level_formatter :public flag_formatter
+// The most used date/time fields, rendered once as an ISO 8601 "YYYY-mm-dd HH:MM:SS" stamp
+struct tm_digits
 {
-    void format(details::log_msg& msg, const std::tm&) override
+    char iso[19];
+
+    const char* year() const
     {
-        msg.formatted << level::to_str(msg.level);
+        return iso;
     }
-};
-
-// short log level appender
-class short_level_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm&) override
+    const char* mon() const
+    {
+        return iso + 5;
+    }
+    const char* mday() const
+    {
+        return iso + 8;
+    }
+    const char* hour() const
+    {
+        return iso + 11;
+    }
+    const char* min() const
     {
-        msg.formatted << level::to_short_str(msg.level);
+        return iso + 14;
+    }
+    const char* sec() const
+    {
+        return iso + 17;
     }
 };
 
-///////////////////////////////////////////////////////////////////////
-// Date time pattern appenders
-///////////////////////////////////////////////////////////////////////
+// Like cached_localtime(), the digits only change once a second, so render them once a second per thread.
+inline const tm_digits& cached_tm_digits(std::time_t t, const std::tm& tm_time)
+{
+    static SPDLOG_THREAD_LOCAL bool cache_valid;
+    static SPDLOG_THREAD_LOCAL std::time_t cached_time;
+    static SPDLOG_THREAD_LOCAL tm_digits cached_digits;
+
+    if (!cache_valid || t != cached_time)
+    {
+        char* p = cached_digits.iso;
+        p = write_padded(p, tm_time.tm_year + 1900, 4);
+        *p++ = '-';
+        p = write_padded(p, tm_time.tm_mon + 1, 2);
+        *p++ = '-';
+        p = write_padded(p, tm_time.tm_mday, 2);
+        *p++ = ' ';
+        p = write_padded(p, tm_time.tm_hour, 2);
+        *p++ = ':';
+        p = write_padded(p, tm_time.tm_min, 2);
+        *p++ = ':';
+        write_padded(p, tm_time.tm_sec, 2);
+        cached_time = t;
+        cache_valid = true;
+    }
+    return cached_digits;
+}
 
-static const char* ampm(const tm& t)
+// Instruction set of a compiled pattern.
+// Unbounded ops append straight to msg.formatted.
+// Bounded width ops (and the short literals between them) are grouped at compile time into runs: they render into a
+// small stack buffer which an end_run op then appends to msg.formatted with a single write.
+enum class pattern_opcode : unsigned char
+{
+    // unbounded width
+    literal,        // _literals[offset, offset + size)
+    text,           // %v
+    source_location, // %@ - file:line
+    source_file,    // %g
+
+    // bounded width
+    run_literal,    // a literal inside a run
+    name,           // %n - names longer than max_name_size are written around the run, as are the two below
+    source_basename, // %s - file without its directory
+    source_funcname, // %!
+    level,          // %l
+    short_level,    // %L
+    thread_id,      // %t
+    weekday,        // %a
+    full_weekday,   // %A
+    month,          // %b %h
+    full_month,     // %B
+    date_time,      // %c
+    year_2,         // %C
+    year,           // %Y
+    short_date,     // %D %x
+    month_num,      // %m
+    day,            // %d
+    hour,           // %H
+    hour_12,        // %I
+    minute,         // %M
+    second,         // %S
+    millis,         // %e
+    micros,         // %f
+    nanos,          // %F
+    ampm,           // %p
+    time_12,        // %r
+    hour_minute,    // %R
+    time,           // %T %X
+    tz_offset,      // %z
+    iso_date,       // %Y-%m-%d
+    iso_datetime,   // %Y-%m-%d %H:%M:%S
+    iso_datetime_t, // %Y-%m-%dT%H:%M:%S
+    source_line,    // %#
+
+    end_run         // append the rendered run to msg.formatted
+};
+
+// max size of a single run
+static const size_t max_run_size = 128;
+
+// room reserved for %n, %s and %! inside a run
+static const size_t max_name_size = 32;
+
+// day and month name, with its size known at compile time
+struct date_name
 {
-    return t.tm_hour >= 12 ? "PM" : "AM";
-}
+    const char* data;
+    size_t size;
+};
 
-static int to12h(const tm& t)
+template<size_t N>
+inline SPDLOG_CONSTEXPR date_name make_date_name(const char (&name)[N])
 {
-    return t.tm_hour > 12 ? t.tm_hour - 12 : t.tm_hour;
+    return date_name { name, N - 1 };
 }
 
 //Abbreviated weekday name
-static const std::string days[] { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
-class a_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << days[tm_time.tm_wday];
-    }
-};
+static SPDLOG_CONSTEXPR date_name days[] { make_date_name("Sun"), make_date_name("Mon"), make_date_name("Tue"), make_date_name("Wed"), make_date_name("Thu"), make_date_name("Fri"), make_date_name("Sat") };
 
 //Full weekday name
-static const std::string full_days[] { "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
-class A_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << full_days[tm_time.tm_wday];
-    }
-};
+static SPDLOG_CONSTEXPR date_name full_days[] { make_date_name("Sunday"), make_date_name("Monday"), make_date_name("Tuesday"), make_date_name("Wednesday"), make_date_name("Thursday"), make_date_name("Friday"), make_date_name("Saturday") };
 
 //Abbreviated month
-static const std::string  months[] { "Jan", "Feb", "Mar", "Apr", "May", "June", "July", "Aug", "Sept", "Oct", "Nov", "Dec" };
-class b_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted<< months[tm_time.tm_mon];
-    }
-};
+static SPDLOG_CONSTEXPR date_name months[] { make_date_name("Jan"), make_date_name("Feb"), make_date_name("Mar"), make_date_name("Apr"), make_date_name("May"), make_date_name("June"), make_date_name("July"), make_date_name("Aug"), make_date_name("Sept"), make_date_name("Oct"), make_date_name("Nov"), make_date_name("Dec") };
 
 //Full month name
-static const std::string full_months[] { "January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December" };
-class B_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << full_months[tm_time.tm_mon];
-    }
-};
+static SPDLOG_CONSTEXPR date_name full_months[] { make_date_name("January"), make_date_name("February"), make_date_name("March"), make_date_name("April"), make_date_name("May"), make_date_name("June"), make_date_name("July"), make_date_name("August"), make_date_name("September"), make_date_name("October"), make_date_name("November"), make_date_name("December") };
 
+inline SPDLOG_CONSTEXPR size_t larger(size_t a, size_t b)
+{
+    return a > b ? a : b;
+}
 
-//write 2 ints seperated by sep with padding of 2
-static fmt::MemoryWriter& pad_n_join(fmt::MemoryWriter& w, int v1, int v2, char sep)
+// size of the longest name in the table
+template<size_t N>
+inline SPDLOG_CONSTEXPR size_t longest_name(const date_name (&names)[N], size_t i = 0)
 {
-    w << fmt::pad(v1, 2, '0') << sep << fmt::pad(v2, 2, '0');
-    return w;
+    return i == N ? 0 : larger(names[i].size, longest_name(names, i + 1));
 }
 
-//write 3 ints seperated by sep with padding of 2
-static fmt::MemoryWriter& pad_n_join(fmt::MemoryWriter& w, int v1, int v2, int v3, char sep)
+// %c: "Thu Aug 23 15:35:46 2014"
+static SPDLOG_CONSTEXPR size_t date_time_width = longest_name(days) + 1 + longest_name(months) + 1 + 2 + 1 + 8 + 1 + 4;
+
+// max output width of each op (in pattern_opcode order), 0 for unbounded ones
+static SPDLOG_CONSTEXPR size_t op_max_widths[] =
+{
+    0, 0,                   // literal, text
+    0, 0,                   // source_location, source_file
+    0, max_name_size,       // run_literal, name
+    max_name_size, max_name_size, // source_basename, source_funcname
+    8, 1, 20,               // level, short_level, thread_id
+    longest_name(days), longest_name(full_days),     // weekday, full_weekday
+    longest_name(months), longest_name(full_months), // month, full_month
+    date_time_width,        // date_time
+    2, 4, 8, 2, 2,          // year_2, year, short_date, month_num, day
+    2, 2, 2, 2,             // hour, hour_12, minute, second
+    3, 6, 9,                // millis, micros, nanos
+    2, 11, 5, 8, 6,         // ampm, time_12, hour_minute, time, tz_offset
+    10, 19, 19,             // iso_date, iso_datetime, iso_datetime_t
+    11,                     // source_line
+    0                       // end_run
+};
+static_assert(sizeof(op_max_widths) / sizeof(op_max_widths[0]) == static_cast<size_t>(pattern_opcode::end_run) + 1, "op_max_widths must cover all opcodes");
+
+inline SPDLOG_CONSTEXPR size_t max_width(pattern_opcode code)
 {
-    w << fmt::pad(v1, 2, '0') << sep << fmt::pad(v2, 2, '0') << sep << fmt::pad(v3, 2, '0');
-    return w;
+    return op_max_widths[static_cast<size_t>(code)];
 }
 
+// opcode of a pattern flag, literal for unknown flags (which appear as is). %+ is expanded by the pattern compilers.
+inline SPDLOG_CONSTEXPR pattern_opcode flag_opcode(char flag)
+{
+    return
+        flag == 'n' ? pattern_opcode::name :
+        flag == 'l' ? pattern_opcode::level :
+        flag == 'L' ? pattern_opcode::short_level :
+        flag == 't' ? pattern_opcode::thread_id :
+        flag == 'v' ? pattern_opcode::text :
+        flag == 'a' ? pattern_opcode::weekday :
+        flag == 'A' ? pattern_opcode::full_weekday :
+        flag == 'b' || flag == 'h' ? pattern_opcode::month :
+        flag == 'B' ? pattern_opcode::full_month :
+        flag == 'c' ? pattern_opcode::date_time :
+        flag == 'C' ? pattern_opcode::year_2 :
+        flag == 'Y' ? pattern_opcode::year :
+        flag == 'D' || flag == 'x' ? pattern_opcode::short_date :
+        flag == 'm' ? pattern_opcode::month_num :
+        flag == 'd' ? pattern_opcode::day :
+        flag == 'H' ? pattern_opcode::hour :
+        flag == 'I' ? pattern_opcode::hour_12 :
+        flag == 'M' ? pattern_opcode::minute :
+        flag == 'S' ? pattern_opcode::second :
+        flag == 'e' ? pattern_opcode::millis :
+        flag == 'f' ? pattern_opcode::micros :
+        flag == 'F' ? pattern_opcode::nanos :
+        flag == 'p' ? pattern_opcode::ampm :
+        flag == 'r' ? pattern_opcode::time_12 :
+        flag == 'R' ? pattern_opcode::hour_minute :
+        flag == 'T' || flag == 'X' ? pattern_opcode::time :
+        flag == 'z' ? pattern_opcode::tz_offset :
+        flag == '@' ? pattern_opcode::source_location :
+        flag == 'g' ? pattern_opcode::source_file :
+        flag == 's' ? pattern_opcode::source_basename :
+        flag == '!' ? pattern_opcode::source_funcname :
+        flag == '#' ? pattern_opcode::source_line :
+        pattern_opcode::literal;
+}
 
-//Date and time representation (Thu Aug 23 15:35:46 2014)
-class c_formatter :public flag_formatter
+// Common ISO 8601 flag sequences, compiled to a single op which copies the cached stamp
+struct iso_sequence
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << days[tm_time.tm_wday] << ' ' << months[tm_time.tm_mon] << ' ' << tm_time.tm_mday << ' ';
-        pad_n_join(msg.formatted, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, ':') << ' ' << tm_time.tm_year + 1900;
-    }
+    const char* pattern;
+    size_t size;
+    pattern_opcode code;
 };
 
-
-// year - 2 digit
-class C_formatter :public flag_formatter
+static SPDLOG_CONSTEXPR iso_sequence iso_sequences[] =
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(tm_time.tm_year % 100, 2, '0');
-    }
+    { "%Y-%m-%d %H:%M:%S", 17, pattern_opcode::iso_datetime },
+    { "%Y-%m-%dT%H:%M:%S", 17, pattern_opcode::iso_datetime_t },
+    { "%Y-%m-%d", 8, pattern_opcode::iso_date }
 };
+static const size_t iso_sequence_count = sizeof(iso_sequences) / sizeof(iso_sequences[0]);
 
+inline SPDLOG_CONSTEXPR bool starts_with(const char* str, const char* prefix)
+{
+    return *prefix == '\0' || (*str == *prefix && starts_with(str + 1, prefix + 1));
+}
 
+// index of the iso sequence str starts with, iso_sequence_count if none
+inline SPDLOG_CONSTEXPR size_t find_iso_sequence(const char* str, size_t i = 0)
+{
+    return i == iso_sequence_count ? i : starts_with(str, iso_sequences[i].pattern) ? i : find_iso_sequence(str, i + 1);
+}
 
-// Short MM/DD/YY date, equivalent to %m/%d/%y 08/23/01
-class D_formatter :public flag_formatter
+// what %+ stands for
+struct full_pattern
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
+    static SPDLOG_CONSTEXPR const char* value()
     {
-        pad_n_join(msg.formatted, tm_time.tm_mon + 1, tm_time.tm_mday, tm_time.tm_year % 100, '/');
+        return
+#ifndef SPDLOG_NO_DATETIME
+            "[%Y-%m-%d %H:%M:%S.%e] "
+#endif
+#ifndef SPDLOG_NO_NAME
+            "[%n] "
+#endif
+            "[%l] %v";
     }
 };
 
+///////////////////////////////////////////////////////////////////////
+// Date time helpers
+///////////////////////////////////////////////////////////////////////
 
-// year - 4 digit
-class Y_formatter :public flag_formatter
+static const char* ampm(const tm& t)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << tm_time.tm_year + 1900;
-    }
-};
+    return t.tm_hour >= 12 ? "PM" : "AM";
+}
 
-// month 1-12
-class m_formatter :public flag_formatter
+static int to12h(const tm& t)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(tm_time.tm_mon + 1, 2, '0');
-    }
-};
+    return t.tm_hour > 12 ? t.tm_hour - 12 : t.tm_hour;
+}
 
-// day of month 1-31
-class d_formatter :public flag_formatter
+static char* write_str(char* p, fmt::StringRef str)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(tm_time.tm_mday, 2, '0');
-    }
-};
+    std::memcpy(p, str.data(), str.size());
+    return p + str.size();
+}
 
-// hours in 24 format  0-23
-class H_formatter :public flag_formatter
+static char* write_str(char* p, const date_name& name)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(tm_time.tm_hour, 2, '0');
-    }
-};
+    std::memcpy(p, name.data, name.size);
+    return p + name.size;
+}
 
-// hours in 12 format  1-12
-class I_formatter :public flag_formatter
+static char* write_str(char* p, const char* str)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(to12h(tm_time), 2, '0');
-    }
-};
+    while (*str)
+        *p++ = *str++;
+    return p;
+}
 
-// ninutes 0-59
-class M_formatter :public flag_formatter
+//write 2 ints seperated by sep with padding of 2
+static char* pad_n_join(char* p, int v1, int v2, char sep)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(tm_time.tm_min, 2, '0');
-    }
-};
+    p = write_padded(p, v1, 2);
+    *p++ = sep;
+    return write_padded(p, v2, 2);
+}
 
-// seconds 0-59
-class S_formatter :public flag_formatter
+//write 3 ints seperated by sep with padding of 2
+static char* pad_n_join(char* p, int v1, int v2, int v3, char sep)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        msg.formatted << fmt::pad(tm_time.tm_sec, 2, '0');
-    }
-};
+    p = pad_n_join(p, v1, v2, sep);
+    *p++ = sep;
+    return write_padded(p, v3, 2);
+}
 
-// milliseconds
-class e_formatter :public flag_formatter
+// fraction of the current second in the given units
+template<typename Units>
+static int second_fraction(const log_msg& msg, long long units_per_sec)
 {
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        auto duration = msg.time.time_since_epoch();
-        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() % 1000;
-        msg.formatted << fmt::pad(static_cast<int>(millis), 3, '0');
-    }
-};
+    auto duration = msg.time.time_since_epoch();
+    return static_cast<int>(std::chrono::duration_cast<Units>(duration).count() % units_per_sec);
+}
 
-// microseconds
-class f_formatter :public flag_formatter
+// offset from UTC in minutes
+inline int utc_minutes_offset(std::time_t t, const std::tm& tm_time)
 {
-    void format(details::log_msg& msg, const std::tm&) override
+#ifdef _WIN32
+    // Expensive under windows - cache it per thread and refresh every few seconds
+    static SPDLOG_THREAD_LOCAL bool cache_valid;
+    static SPDLOG_THREAD_LOCAL std::time_t last_update;
+    static SPDLOG_THREAD_LOCAL int offset_minutes;
+    if (!cache_valid || t - last_update >= 5 || t < last_update)
     {
-        auto duration = msg.time.time_since_epoch();
-        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count() % 1000000;
-        msg.formatted << fmt::pad(static_cast<int>(micros), 6, '0');
+        offset_minutes = os::utc_minutes_offset(tm_time);
+        last_update = t;
+        cache_valid = true;
     }
-};
+    return offset_minutes;
+#else
+    // No need to chache under gcc,
+    // it is very fast (already stored in tm.tm_gmtoff)
+    (void)t;
+    return os::utc_minutes_offset(tm_time);
+#endif
+}
 
-// nanoseconds
-class F_formatter :public flag_formatter
+// what the bounded ops need to render a message
+struct format_context
 {
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        auto duration = msg.time.time_since_epoch();
-        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() % 1000000000;
-        msg.formatted << fmt::pad(static_cast<int>(ns), 9, '0');
-    }
+    const log_msg& msg;
+    std::time_t time;
+    const std::tm& tm_time;
+    const tm_digits& digits;
 };
 
-// AM/PM
-class p_formatter :public flag_formatter
+// render a bounded op (other than run_literal and name) into p, returns the position after it.
+// templated on the opcode so both the pattern_formatter dispatch loop and static_pattern_formatter get a branch free
+// writer for each field.
+template<pattern_opcode Code>
+inline char* write_field(char* p, const format_context& ctx)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
+    switch (Code)
     {
-        msg.formatted << ampm(tm_time);
-    }
-};
+    case pattern_opcode::level:
+        p = write_str(p, level::to_str(ctx.msg.level));
+        break;
 
+    case pattern_opcode::short_level:
+        p = write_str(p, level::to_short_str(ctx.msg.level));
+        break;
 
-// 12 hour clock 02:55:02 pm
-class r_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
+    case pattern_opcode::thread_id:
     {
-        pad_n_join(msg.formatted, to12h(tm_time), tm_time.tm_min, tm_time.tm_sec, ':') << ' ' << ampm(tm_time);
+        fmt::FormatInt id(ctx.msg.thread_id);
+        std::memcpy(p, id.data(), id.size());
+        p += id.size();
+        break;
     }
-};
 
-// 24-hour HH:MM time, equivalent to %H:%M
-class R_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        pad_n_join(msg.formatted, tm_time.tm_hour, tm_time.tm_min, ':');
-    }
-};
+    case pattern_opcode::weekday:
+        p = write_str(p, days[ctx.tm_time.tm_wday]);
+        break;
 
-// ISO 8601 time format (HH:MM:SS), equivalent to %H:%M:%S
-class T_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-        pad_n_join(msg.formatted, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, ':');
-    }
-};
+    case pattern_opcode::full_weekday:
+        p = write_str(p, full_days[ctx.tm_time.tm_wday]);
+        break;
 
+    case pattern_opcode::month:
+        p = write_str(p, months[ctx.tm_time.tm_mon]);
+        break;
 
-// ISO 8601 offset from UTC in timezone (+-HH:MM)
-class z_formatter :public flag_formatter
-{
-public:
-    const std::chrono::seconds cache_refresh = std::chrono::seconds(5);
+    case pattern_opcode::full_month:
+        p = write_str(p, full_months[ctx.tm_time.tm_mon]);
+        break;
 
-    z_formatter() :_last_update(std::chrono::seconds(0)) {}
-    z_formatter(const z_formatter&) = delete;
-    z_formatter& operator=(const z_formatter&) = delete;
+    //Date and time representation (Thu Aug 23 15:35:46 2014)
+    case pattern_opcode::date_time:
+        p = write_str(p, days[ctx.tm_time.tm_wday]);
+        *p++ = ' ';
+        p = write_str(p, months[ctx.tm_time.tm_mon]);
+        *p++ = ' ';
+        p = write_padded(p, ctx.tm_time.tm_mday, ctx.tm_time.tm_mday < 10 ? 1 : 2);
+        *p++ = ' ';
+        p = pad_n_join(p, ctx.tm_time.tm_hour, ctx.tm_time.tm_min, ctx.tm_time.tm_sec, ':');
+        *p++ = ' ';
+        std::memcpy(p, ctx.digits.year(), 4);
+        p += 4;
+        break;
 
-    void format(details::log_msg& msg, const std::tm& tm_time) override
-    {
-#ifdef _WIN32
-        int total_minutes = get_cached_offset(msg, tm_time);
-#else
-        // No need to chache under gcc,
-        // it is very fast (already stored in tm.tm_gmtoff)
-        int total_minutes = os::utc_minutes_offset(tm_time);
-#endif
+    case pattern_opcode::year_2:
+        p = write_padded(p, ctx.tm_time.tm_year % 100, 2);
+        break;
 
-        int h = total_minutes / 60;
-        int m = total_minutes % 60;
-        char sign = h >= 0 ? '+' : '-';
-        msg.formatted << sign;
-        pad_n_join(msg.formatted, h, m, ':');
-    }
-private:
-    log_clock::time_point _last_update;
-    int _offset_minutes;
-    std::mutex _mutex;
+    case pattern_opcode::year:
+        std::memcpy(p, ctx.digits.year(), 4);
+        p += 4;
+        break;
 
-    int get_cached_offset(const log_msg& msg, const std::tm& tm_time)
-    {
-        using namespace std::chrono;
-        std::lock_guard<std::mutex> l(_mutex);
-        if (msg.time - _last_update >= cache_refresh)
-        {
-            _offset_minutes = os::utc_minutes_offset(tm_time);
-            _last_update = msg.time;
-        }
-        return _offset_minutes;
-    }
-};
+    // Short MM/DD/YY date, equivalent to %m/%d/%y 08/23/01
+    case pattern_opcode::short_date:
+        p = pad_n_join(p, ctx.tm_time.tm_mon + 1, ctx.tm_time.tm_mday, ctx.tm_time.tm_year % 100, '/');
+        break;
 
+    case pattern_opcode::month_num:
+        std::memcpy(p, ctx.digits.mon(), 2);
+        p += 2;
+        break;
 
+    case pattern_opcode::day:
+        std::memcpy(p, ctx.digits.mday(), 2);
+        p += 2;
+        break;
 
-//Thread id
-class t_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        msg.formatted << msg.thread_id;
-    }
-};
+    case pattern_opcode::hour:
+        std::memcpy(p, ctx.digits.hour(), 2);
+        p += 2;
+        break;
 
+    case pattern_opcode::hour_12:
+        p = write_padded(p, to12h(ctx.tm_time), 2);
+        break;
 
-class v_formatter :public flag_formatter
-{
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        msg.formatted << fmt::StringRef(msg.raw.data(), msg.raw.size());
-    }
-};
+    case pattern_opcode::minute:
+        std::memcpy(p, ctx.digits.min(), 2);
+        p += 2;
+        break;
 
-class ch_formatter :public flag_formatter
-{
-public:
-    explicit ch_formatter(char ch) : _ch(ch)
-    {}
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        msg.formatted << _ch;
-    }
-private:
-    char _ch;
-};
+    case pattern_opcode::second:
+        std::memcpy(p, ctx.digits.sec(), 2);
+        p += 2;
+        break;
+
+    case pattern_opcode::millis:
+        p = write_padded(p, second_fraction<std::chrono::milliseconds>(ctx.msg, 1000), 3);
+        break;
 
+    case pattern_opcode::micros:
+        p = write_padded(p, second_fraction<std::chrono::microseconds>(ctx.msg, 1000000), 6);
+        break;
 
-//aggregate user chars to display as is
-class aggregate_formatter :public flag_formatter
-{
-public:
-    aggregate_formatter()
-    {}
-    void add_ch(char ch)
+    case pattern_opcode::nanos:
+        p = write_padded(p, second_fraction<std::chrono::nanoseconds>(ctx.msg, 1000000000), 9);
+        break;
+
+    case pattern_opcode::ampm:
+        std::memcpy(p, ampm(ctx.tm_time), 2);
+        p += 2;
+        break;
+
+    // 12 hour clock 02:55:02 pm
+    case pattern_opcode::time_12:
+        p = pad_n_join(p, to12h(ctx.tm_time), ctx.tm_time.tm_min, ctx.tm_time.tm_sec, ':');
+        *p++ = ' ';
+        std::memcpy(p, ampm(ctx.tm_time), 2);
+        p += 2;
+        break;
+
+    // 24-hour HH:MM time, equivalent to %H:%M
+    case pattern_opcode::hour_minute:
+        p = pad_n_join(p, ctx.tm_time.tm_hour, ctx.tm_time.tm_min, ':');
+        break;
+
+    // ISO 8601 time format (HH:MM:SS), equivalent to %H:%M:%S
+    case pattern_opcode::time:
+        std::memcpy(p, ctx.digits.hour(), 8);
+        p += 8;
+        break;
+
+    // ISO 8601 offset from UTC in timezone (+-HH:MM)
+    case pattern_opcode::tz_offset:
     {
-        _str += ch;
+        int total_minutes = utc_minutes_offset(ctx.time, ctx.tm_time);
+        *p++ = total_minutes >= 0 ? '+' : '-';
+        total_minutes = std::abs(total_minutes);
+        p = pad_n_join(p, total_minutes / 60, total_minutes % 60, ':');
+        break;
     }
-    void format(details::log_msg& msg, const std::tm&) override
-    {
-        msg.formatted << _str;
+    case pattern_opcode::iso_date:
+        std::memcpy(p, ctx.digits.iso, 10);
+        p += 10;
+        break;
+
+    case pattern_opcode::iso_datetime:
+        std::memcpy(p, ctx.digits.iso, 19);
+        p += 19;
+        break;
+
+    case pattern_opcode::iso_datetime_t:
+        std::memcpy(p, ctx.digits.iso, 19);
+        p[10] = 'T';
+        p += 19;
+        break;
+
+    case pattern_opcode::source_line:
+        if (ctx.msg.source)
+        {
+            fmt::FormatInt line(ctx.msg.source->line);
+            std::memcpy(p, line.data(), line.size());
+            p += line.size();
+        }
+        break;
+
+    default:
+        break;
     }
-private:
-    std::string _str;
-};
+    return p;
+}
 
-// Full info formatter
-// pattern: [%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v
-class full_formatter :public flag_formatter
+// the file name without its directory
+inline const char* source_basename(const char* filename)
 {
-    void format(details::log_msg& msg, const std::tm& tm_time) override
+    const char* base = filename;
+    for (auto p = filename; *p; ++p)
     {
-#ifndef SPDLOG_NO_DATETIME
-        auto duration = msg.time.time_since_epoch();
-        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() % 1000;
-
-        /* Slower version(while still very fast - about 3.2 million lines/sec under 10 threads),
-        msg.formatted.write("[{:d}-{:02d}-{:02d} {:02d}:{:02d}:{:02d}.{:03d}] [{}] [{}] {} ",
-        tm_time.tm_year + 1900,
-        tm_time.tm_mon + 1,
-        tm_time.tm_mday,
-        tm_time.tm_hour,
-        tm_time.tm_min,
-        tm_time.tm_sec,
-        static_cast<int>(millis),
-        msg.logger_name,
-        level::to_str(msg.level),
-        msg.raw.str());*/
-
-
-        // Faster (albeit uglier) way to format the line (5.6 million lines/sec under 10 threads)
-        msg.formatted << '[' << static_cast<unsigned int>(tm_time.tm_year + 1900) << '-'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_mon + 1), 2, '0') << '-'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_mday), 2, '0') << ' '
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_hour), 2, '0') << ':'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_min), 2, '0') << ':'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_sec), 2, '0') << '.'
-                      << fmt::pad(static_cast<unsigned int>(millis), 3, '0') << "] ";
-
-//no datetime needed
+#ifdef _WIN32
+        if (*p == '\\' || *p == '/')
 #else
-        (void)tm_time;
+        if (*p == '/')
 #endif
+            base = p + 1;
+    }
+    return base;
+}
 
-#ifndef SPDLOG_NO_NAME
-        msg.formatted << '[' << msg.logger_name << "] ";
-#endif
+// render an unbounded source location op (%@ %g) to w. nothing if the message has no source location
+template<pattern_opcode Code>
+inline void write_source_field(fmt::MemoryWriter& w, const log_msg& msg)
+{
+    if (!msg.source)
+        return;
+
+    switch (Code)
+    {
+    case pattern_opcode::source_location:
+        w << fmt::StringRef(msg.source->filename) << ':' << msg.source->line;
+        break;
+
+    case pattern_opcode::source_file:
+        w << fmt::StringRef(msg.source->filename);
+        break;
 
-        msg.formatted << '[' << level::to_str(msg.level) << "] ";
-        msg.formatted << fmt::StringRef(msg.raw.data(), msg.raw.size());
+    default:
+        break;
     }
-};
+}
+
+// the text of a string op of a run (%n %s %!). empty for source fields of messages without a source location
+template<pattern_opcode Code>
+inline fmt::StringRef run_str(const log_msg& msg)
+{
+    return
+        Code == pattern_opcode::name ? msg.logger_name :
+        !msg.source ? fmt::StringRef("", 0) :
+        Code == pattern_opcode::source_basename ? fmt::StringRef(source_basename(msg.source->filename)) :
+        fmt::StringRef(msg.source->funcname);
+}
+
+// write a string op into the run [run, p), if it fits in max_name_size.
+// otherwise flush the run so far and write the string directly to w. returns the new end of the run
+inline char* write_run_str(char* run, char* p, fmt::MemoryWriter& w, fmt::StringRef str)
+{
+    if (str.size() <= max_name_size)
+        return write_str(p, str);
+    w << fmt::StringRef(run, static_cast<size_t>(p - run)) << str;
+    return run;
+}
 
 }
 }
@@ -464,173 +682,305 @@ class full_formatter :public flag_formatter
 ///////////////////////////////////////////////////////////////////////////////
 inline spdlog::pattern_formatter::pattern_formatter(const std::string& pattern)
 {
-    compile_pattern(pattern);
+    std::string user_chars;
+    compile_pattern(pattern, user_chars);
+    add_literal(user_chars);
+    merge_runs();
 }
 
-inline void spdlog::pattern_formatter::compile_pattern(const std::string& pattern)
+inline void spdlog::pattern_formatter::compile_pattern(const std::string& pattern, std::string& user_chars)
 {
     auto end = pattern.end();
-    std::unique_ptr<details::aggregate_formatter> user_chars;
     for (auto it = pattern.begin(); it != end; ++it)
     {
         if (*it == '%')
         {
-            if (user_chars) //append user chars found so far
-                _formatters.push_back(std::move(user_chars));
-
-            if (++it != end)
-                handle_flag(*it);
+            auto seq = details::find_iso_sequence(pattern.c_str() + (it - pattern.begin()));
+            if (seq != details::iso_sequence_count)
+            {
+                add_op(details::iso_sequences[seq].code, user_chars);
+                it += details::iso_sequences[seq].size - 1;
+            }
+            else if (++it != end)
+                handle_flag(*it, user_chars);
             else
                 break;
         }
         else // chars not following the % sign should be displayed as is
         {
-            if (!user_chars)
-                user_chars = std::unique_ptr<details::aggregate_formatter>(new details::aggregate_formatter());
-            user_chars->add_ch(*it);
+            user_chars += *it;
         }
     }
-    if (user_chars) //append raw chars found so far
+}
+
+inline void spdlog::pattern_formatter::add_literal(std::string& user_chars)
+{
+    if (user_chars.empty())
+        return;
+    details::pattern_op op { details::pattern_opcode::literal, static_cast<unsigned int>(_literals.size()), static_cast<unsigned int>(user_chars.size()) };
+    _literals += user_chars;
+    _ops.push_back(op);
+    user_chars.clear();
+}
+
+inline void spdlog::pattern_formatter::add_op(details::pattern_opcode code, std::string& user_chars)
+{
+    add_literal(user_chars); //append user chars found so far
+    details::pattern_op op { code, 0, 0 };
+    _ops.push_back(op);
+}
+
+inline void spdlog::pattern_formatter::handle_flag(char flag, std::string& user_chars)
+{
+    // Full info: [%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v
+    if (flag == '+')
     {
-        _formatters.push_back(std::move(user_chars));
+        compile_pattern(details::full_pattern::value(), user_chars);
+        return;
     }
 
+    auto code = details::flag_opcode(flag);
+    if (code == details::pattern_opcode::literal) //Unkown flag appears as is
+    {
+        user_chars += '%';
+        user_chars += flag;
+    }
+    else
+    {
+        add_op(code, user_chars);
+    }
 }
-inline void spdlog::pattern_formatter::handle_flag(char flag)
+
+// Group adjacent bounded width ops, together with the literals between them, into runs terminated by an end_run op.
+// e.g. "[%Y-%m-%d %H:%M:%S.%e] [" becomes a single 27 chars write per message.
+inline void spdlog::pattern_formatter::merge_runs()
 {
-    switch (flag)
+    using details::pattern_opcode;
+    std::vector<details::pattern_op> ops;
+    size_t run_start = 0;
+    size_t run_size = 0;
+    bool in_run = false;
+    bool run_has_fields = false;
+
+    auto close_run = [&]()
     {
-    // logger name
-    case 'n':
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::name_formatter()));
-        break;
+        if (!in_run)
+            return;
+        if (run_has_fields)
+        {
+            details::pattern_op op { pattern_opcode::end_run, 0, static_cast<unsigned int>(run_size) };
+            ops.push_back(op);
+        }
+        else // literals only - no need for a run
+        {
+            for (auto i = run_start; i < ops.size(); ++i)
+                ops[i].code = pattern_opcode::literal;
+        }
+        in_run = false;
+    };
 
-    case 'l':
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::level_formatter()));
-        break;
+    for (auto op : _ops)
+    {
+        auto width = op.code == pattern_opcode::literal ? op.size : details::max_width(op.code);
+        if (width == 0 || width > details::max_run_size)
+        {
+            close_run();
+            ops.push_back(op);
+            continue;
+        }
+        if (in_run && run_size + width > details::max_run_size)
+            close_run();
+        if (!in_run)
+        {
+            in_run = true;
+            run_start = ops.size();
+            run_size = 0;
+            run_has_fields = false;
+        }
+        if (op.code == pattern_opcode::literal)
+            op.code = pattern_opcode::run_literal;
+        else
+            run_has_fields = true;
+        run_size += width;
+        ops.push_back(op);
+    }
+    close_run();
+    _ops.swap(ops);
+}
 
-    case 'L':
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::short_level_formatter()));
-        break;
 
-    case('t') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::t_formatter()));
-        break;
+inline void spdlog::pattern_formatter::format(details::log_msg& msg)
+{
+    using details::pattern_opcode;
+    try
+    {
+        auto t = log_clock::to_time_t(msg.time);
+        const auto& tm_time = details::cached_localtime(t);
+        const details::format_context ctx { msg, t, tm_time, details::cached_tm_digits(t, tm_time) };
+        char run[details::max_run_size];
+        char* p = run;
+        for (const auto& op : _ops)
+        {
+            switch (op.code)
+            {
+            case pattern_opcode::literal:
+                msg.formatted << fmt::StringRef(_literals.data() + op.offset, op.size);
+                break;
 
-    case('v') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::v_formatter()));
-        break;
+            case pattern_opcode::text:
+                msg.formatted << fmt::StringRef(msg.raw.data(), msg.raw.size());
+                break;
 
-    case('a') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::a_formatter()));
-        break;
+            case pattern_opcode::source_location:
+                details::write_source_field<pattern_opcode::source_location>(msg.formatted, msg);
+                break;
 
-    case('A') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::A_formatter()));
-        break;
+            case pattern_opcode::source_file:
+                details::write_source_field<pattern_opcode::source_file>(msg.formatted, msg);
+                break;
 
-    case('b') :
-    case('h') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::b_formatter()));
-        break;
 
-    case('B') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::B_formatter()));
-        break;
-    case('c') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::c_formatter()));
-        break;
+            case pattern_opcode::run_literal:
+                if (op.size == 1) // mostly separators - avoid the memcpy call
+                    *p = _literals[op.offset];
+                else
+                    std::memcpy(p, _literals.data() + op.offset, op.size);
+                p += op.size;
+                break;
 
-    case('C') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::C_formatter()));
-        break;
+            case pattern_opcode::name:
+                p = details::write_run_str(run, p, msg.formatted, details::run_str<pattern_opcode::name>(msg));
+                break;
 
-    case('Y') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::Y_formatter()));
-        break;
+            case pattern_opcode::source_basename:
+                p = details::write_run_str(run, p, msg.formatted, details::run_str<pattern_opcode::source_basename>(msg));
+                break;
 
-    case('D') :
-    case('x') :
+            case pattern_opcode::source_funcname:
+                p = details::write_run_str(run, p, msg.formatted, details::run_str<pattern_opcode::source_funcname>(msg));
+                break;
 
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::D_formatter()));
-        break;
+            case pattern_opcode::level:
+                p = details::write_field<pattern_opcode::level>(p, ctx);
+                break;
 
-    case('m') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::m_formatter()));
-        break;
+            case pattern_opcode::short_level:
+                p = details::write_field<pattern_opcode::short_level>(p, ctx);
+                break;
 
-    case('d') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::d_formatter()));
-        break;
+            case pattern_opcode::thread_id:
+                p = details::write_field<pattern_opcode::thread_id>(p, ctx);
+                break;
 
-    case('H') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::H_formatter()));
-        break;
+            case pattern_opcode::weekday:
+                p = details::write_field<pattern_opcode::weekday>(p, ctx);
+                break;
 
-    case('I') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::I_formatter()));
-        break;
+            case pattern_opcode::full_weekday:
+                p = details::write_field<pattern_opcode::full_weekday>(p, ctx);
+                break;
 
-    case('M') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::M_formatter()));
-        break;
+            case pattern_opcode::month:
+                p = details::write_field<pattern_opcode::month>(p, ctx);
+                break;
 
-    case('S') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::S_formatter()));
-        break;
+            case pattern_opcode::full_month:
+                p = details::write_field<pattern_opcode::full_month>(p, ctx);
+                break;
 
-    case('e') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::e_formatter()));
-        break;
+            case pattern_opcode::date_time:
+                p = details::write_field<pattern_opcode::date_time>(p, ctx);
+                break;
 
-    case('f') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::f_formatter()));
-        break;
-    case('F') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::F_formatter()));
-        break;
+            case pattern_opcode::year_2:
+                p = details::write_field<pattern_opcode::year_2>(p, ctx);
+                break;
 
-    case('p') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::p_formatter()));
-        break;
+            case pattern_opcode::year:
+                p = details::write_field<pattern_opcode::year>(p, ctx);
+                break;
 
-    case('r') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::r_formatter()));
-        break;
+            case pattern_opcode::short_date:
+                p = details::write_field<pattern_opcode::short_date>(p, ctx);
+                break;
 
-    case('R') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::R_formatter()));
-        break;
+            case pattern_opcode::month_num:
+                p = details::write_field<pattern_opcode::month_num>(p, ctx);
+                break;
 
-    case('T') :
-    case('X') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::T_formatter()));
-        break;
+            case pattern_opcode::day:
+                p = details::write_field<pattern_opcode::day>(p, ctx);
+                break;
 
-    case('z') :
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::z_formatter()));
-        break;
+            case pattern_opcode::hour:
+                p = details::write_field<pattern_opcode::hour>(p, ctx);
+                break;
 
-    case ('+'):
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::full_formatter()));
-        break;
+            case pattern_opcode::hour_12:
+                p = details::write_field<pattern_opcode::hour_12>(p, ctx);
+                break;
 
-    default: //Unkown flag appears as is
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::ch_formatter('%')));
-        _formatters.push_back(std::unique_ptr<details::flag_formatter>(new details::ch_formatter(flag)));
-        break;
-    }
-}
+            case pattern_opcode::minute:
+                p = details::write_field<pattern_opcode::minute>(p, ctx);
+                break;
 
+            case pattern_opcode::second:
+                p = details::write_field<pattern_opcode::second>(p, ctx);
+                break;
 
-inline void spdlog::pattern_formatter::format(details::log_msg& msg)
-{
-    try
-    {
-        auto tm_time = details::os::localtime(log_clock::to_time_t(msg.time));
-        for (auto &f : _formatters)
-        {
-            f->format(msg, tm_time);
+            case pattern_opcode::millis:
+                p = details::write_field<pattern_opcode::millis>(p, ctx);
+                break;
+
+            case pattern_opcode::micros:
+                p = details::write_field<pattern_opcode::micros>(p, ctx);
+                break;
+
+            case pattern_opcode::nanos:
+                p = details::write_field<pattern_opcode::nanos>(p, ctx);
+                break;
+
+            case pattern_opcode::ampm:
+                p = details::write_field<pattern_opcode::ampm>(p, ctx);
+                break;
+
+            case pattern_opcode::time_12:
+                p = details::write_field<pattern_opcode::time_12>(p, ctx);
+                break;
+
+            case pattern_opcode::hour_minute:
+                p = details::write_field<pattern_opcode::hour_minute>(p, ctx);
+                break;
+
+            case pattern_opcode::time:
+                p = details::write_field<pattern_opcode::time>(p, ctx);
+                break;
+
+            case pattern_opcode::tz_offset:
+                p = details::write_field<pattern_opcode::tz_offset>(p, ctx);
+                break;
+
+            case pattern_opcode::iso_date:
+                p = details::write_field<pattern_opcode::iso_date>(p, ctx);
+                break;
+
+            case pattern_opcode::iso_datetime:
+                p = details::write_field<pattern_opcode::iso_datetime>(p, ctx);
+                break;
+
+            case pattern_opcode::iso_datetime_t:
+                p = details::write_field<pattern_opcode::iso_datetime_t>(p, ctx);
+                break;
+
+            case pattern_opcode::source_line:
+                p = details::write_field<pattern_opcode::source_line>(p, ctx);
+                break;
+
+            case pattern_opcode::end_run:
+                msg.formatted << fmt::StringRef(run, static_cast<size_t>(p - run));
+                p = run;
+                break;
+            }
         }
         //write eol
         msg.formatted << details::os::eol();
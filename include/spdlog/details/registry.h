@@ -69,8 +69,14 @@ public:
         std::lock_guard<Mutex> lock(_mutex);
 
 
-        if (_async_mode)
-            new_logger = std::make_shared<async_logger>(logger_name, sinks_begin, sinks_end, _async_q_size, _overflow_policy, _worker_warmup_cb, _flush_interval_ms);
+        if (_async_mode && _async_shared_pool)
+        {
+            if (!_async_pool)
+                _async_pool = std::make_shared<async_log_helper>(_async_q_size, _overflow_policy, _worker_warmup_cb, _flush_interval_ms, _async_q_type, _async_wait_strategy, _async_worker_threads);
+            new_logger = std::make_shared<async_logger>(logger_name, sinks_begin, sinks_end, _async_pool);
+        }
+        else if (_async_mode)
+            new_logger = std::make_shared<async_logger>(logger_name, sinks_begin, sinks_end, _async_q_size, _overflow_policy, _worker_warmup_cb, _flush_interval_ms, _async_q_type, _async_wait_strategy, _async_worker_threads);
         else
             new_logger = std::make_shared<logger>(logger_name, sinks_begin, sinks_end);
 
@@ -128,7 +134,7 @@ public:
         _level = log_level;
     }
 
-    void set_async_mode(size_t q_size, const async_overflow_policy overflow_policy, const std::function<void()>& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms)
+    void set_async_mode(size_t q_size, const async_overflow_policy overflow_policy, const worker_warmup_callback& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms, const async_queue_type queue_type, const async_wait_strategy wait_strategy, size_t worker_threads, bool shared_pool)
     {
         std::lock_guard<Mutex> lock(_mutex);
         _async_mode = true;
@@ -136,12 +142,19 @@ public:
         _overflow_policy = overflow_policy;
         _worker_warmup_cb = worker_warmup_cb;
         _flush_interval_ms = flush_interval_ms;
+        _async_q_type = queue_type;
+        _async_wait_strategy = wait_strategy;
+        _async_worker_threads = worker_threads;
+        _async_shared_pool = shared_pool;
+        // loggers created from now on use the new settings. existing loggers keep the previous pool alive.
+        _async_pool.reset();
     }
 
     void set_sync_mode()
     {
         std::lock_guard<Mutex> lock(_mutex);
         _async_mode = false;
+        _async_pool.reset();
     }
 
     static registry_t<Mutex>& instance()
@@ -168,8 +181,13 @@ private:
     bool _async_mode = false;
     size_t _async_q_size = 0;
     async_overflow_policy _overflow_policy = async_overflow_policy::block_retry;
-    std::function<void()> _worker_warmup_cb = nullptr;
+    worker_warmup_callback _worker_warmup_cb = nullptr;
     std::chrono::milliseconds _flush_interval_ms;
+    async_queue_type _async_q_type = async_queue_type::mpmc;
+    async_wait_strategy _async_wait_strategy = async_wait_strategy::backoff;
+    size_t _async_worker_threads = 1;
+    bool _async_shared_pool = false;
+    std::shared_ptr<async_log_helper> _async_pool;
 };
 #ifdef SPDLOG_NO_REGISTRY_MUTEX
 typedef registry_t<spdlog::details::null_mutex> registry;
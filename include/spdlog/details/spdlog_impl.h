@@ -137,9 +137,9 @@ inline void spdlog::set_level(level::level_enum log_level)
 }
 
 
-inline void spdlog::set_async_mode(size_t queue_size, const async_overflow_policy overflow_policy, const std::function<void()>& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms)
+inline void spdlog::set_async_mode(size_t queue_size, const async_overflow_policy overflow_policy, const worker_warmup_callback& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms, const async_queue_type queue_type, const async_wait_strategy wait_strategy, size_t worker_threads, bool shared_pool)
 {
-    details::registry::instance().set_async_mode(queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms);
+    details::registry::instance().set_async_mode(queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, queue_type, wait_strategy, worker_threads, shared_pool);
 }
 
 inline void spdlog::set_sync_mode()
@@ -0,0 +1,513 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#pragma once
+
+// Bounded single producer/single consumer queue (wait-free),
+// and a multi producer queue built of such a queue per producer thread.
+//
+// per_producer_queue:
+// Each producer thread lazily gets its own spsc ring on its first enqueue, so producers never contend with each other.
+// The single consumer drains the rings either in round robin or in timestamp order (using the item's "time" member).
+// Order is preserved per producer thread. In timestamp order mode items are also ordered across producers.
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "../common.h"
+
+namespace spdlog
+{
+namespace details
+{
+
+template<typename T>
+class spsc_bounded_queue
+{
+public:
+
+    using item_type = T;
+    explicit spsc_bounded_queue(size_t buffer_size) :
+        _buffer(new T[check_size(buffer_size)]),
+        _buffer_mask(buffer_size - 1),
+        _tail(0),
+        _head_cache(0),
+        _head(0),
+        _tail_cache(0)
+    {}
+
+    spsc_bounded_queue(const spsc_bounded_queue&) = delete;
+    spsc_bounded_queue& operator=(const spsc_bounded_queue&) = delete;
+
+    // producer only
+    bool enqueue(T&& data)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache > _buffer_mask)
+        {
+            // seems full - refresh the consumer position
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache > _buffer_mask)
+                return false;
+        }
+        _buffer[tail & _buffer_mask] = std::move(data);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only. return the next item without removing it, or nullptr if empty
+    T* front()
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_cache)
+        {
+            // seems empty - refresh the producer position
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            if (head == _tail_cache)
+                return nullptr;
+        }
+        return &_buffer[head & _buffer_mask];
+    }
+
+    // consumer only. remove the item returned by front()
+    void pop()
+    {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer only
+    bool dequeue(T& data)
+    {
+        T* item = front();
+        if (!item)
+            return false;
+        data = std::move(*item);
+        pop();
+        return true;
+    }
+
+    // number of items in the queue. only a snapshot when used concurrently with enqueue/dequeue
+    size_t approx_size() const
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    // number of items enqueued so far
+    size_t enqueued_count() const
+    {
+        return _tail.load(std::memory_order_relaxed);
+    }
+
+    static size_t check_size(size_t buffer_size)
+    {
+        //queue size must be power of two
+        if (!((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0)))
+            throw spdlog_ex("async logger queue size must be power of two");
+        return buffer_size;
+    }
+
+private:
+
+    static size_t const cacheline_size = 64;
+    typedef char cacheline_pad_t[cacheline_size];
+
+    cacheline_pad_t _pad0;
+    const std::unique_ptr<T[]> _buffer;
+    const size_t _buffer_mask;
+    cacheline_pad_t _pad1;
+    // written by the producer
+    std::atomic<size_t> _tail;
+    size_t _head_cache;
+    cacheline_pad_t _pad2;
+    // written by the consumer
+    std::atomic<size_t> _head;
+    size_t _tail_cache;
+    cacheline_pad_t _pad3;
+};
+
+
+template<typename T>
+class per_producer_queue
+{
+public:
+    using item_type = T;
+    using ring_type = spsc_bounded_queue<T>;
+
+    // ring_size: size of each producer's ring (must be power of two)
+    //
+    // Memory: every producer thread gets a ring of ring_size items on its first enqueue,
+    // so each producer thread costs ring_size * sizeof(T) (e.g. about 2.75MB for a ring of 8192 async log messages).
+    // The ring of an exited thread is freed once the consumer has drained it.
+    // With visual studio 2013 (no thread exit hook) rings are only freed with the queue, or reused by a recycled thread id.
+    per_producer_queue(size_t ring_size, bool timestamp_order) :
+        _id(next_id()),
+        _slot(acquire_slot()),
+        _ring_size(ring_size),
+        _timestamp_order(timestamp_order),
+        _rings_version(0),
+        _freed_enqueued(0),
+        _consumer_version(0),
+        _next_ring(0)
+    {
+        // fail early on bad sizes
+        ring_type::check_size(ring_size);
+        _exiting_ring = std::make_shared<producer_ring>(ring_size, std::thread::id());
+        _all_rings.push_back(_exiting_ring);
+    }
+
+    ~per_producer_queue()
+    {
+        release_slot(_slot);
+    }
+
+    per_producer_queue(const per_producer_queue&) = delete;
+    per_producer_queue& operator=(const per_producer_queue&) = delete;
+
+    bool enqueue(T&& data)
+    {
+        auto ring = thread_ring();
+        if (ring)
+            return ring->enqueue(std::move(data));
+
+        // the calling thread is exiting (e.g. logging from a thread local's destructor) and its ring may be freed already.
+        // share a ring with the other exiting threads
+        std::lock_guard<std::mutex> lock(_exiting_mutex);
+        return _exiting_ring->ring.enqueue(std::move(data));
+    }
+
+    // consumer only
+    bool dequeue(T& data)
+    {
+        if (_rings_version.load(std::memory_order_acquire) != _consumer_version)
+            refresh_consumer_rings();
+        if (_timestamp_order ? dequeue_oldest(data) : dequeue_next(data))
+            return true;
+        free_abandoned_rings();
+        return false;
+    }
+
+    // number of items in the calling producer's ring. only a snapshot when used concurrently with dequeue
+    size_t producer_approx_size()
+    {
+        auto ring = thread_ring();
+        return ring ? ring->approx_size() : _exiting_ring->ring.approx_size();
+    }
+
+    // number of items in all the rings. only a snapshot when used concurrently with enqueue/dequeue
+    size_t approx_size()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        size_t size = 0;
+        for (auto& r : _all_rings)
+            size += r->ring.approx_size();
+        return size;
+    }
+
+    // consumer only. number of items in the rings known to the consumer, without taking the mutex
+    size_t consumer_approx_size() const
+    {
+        size_t size = 0;
+        for (auto r : _consumer_rings)
+            size += r->ring.approx_size();
+        return size;
+    }
+
+    // number of items enqueued so far
+    uint64_t enqueued_count()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint64_t count = _freed_enqueued;
+        for (auto& r : _all_rings)
+            count += r->ring.enqueued_count();
+        return count;
+    }
+
+    // number of producer rings currently allocated (including the shared one of exiting threads)
+    size_t ring_count()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _all_rings.size();
+    }
+
+private:
+    struct producer_ring
+    {
+        producer_ring(size_t size, std::thread::id owner_id) :
+            ring(size),
+            owner(owner_id),
+            abandoned(false) {}
+
+        ring_type ring;
+        std::thread::id owner;
+        // set when the owner thread exited. it never enqueues again, so the ring can be freed once empty
+        std::atomic<bool> abandoned;
+    };
+
+    // the calling thread's rings, looked up before taking the mutex.
+    // indexed by the queues' slots, which are dense (reused after the queue is destroyed) so the array stays small,
+    // with the queue's unique id to tell a live queue from a destroyed one of the same slot.
+    struct producer_cache
+    {
+        struct entry
+        {
+            size_t queue_id;
+            ring_type* ring;
+        };
+        entry* entries; // heap allocated, freed when the thread exits (leaked by visual studio 2013 threads)
+        size_t capacity;
+        bool exited; // the thread's rings were abandoned
+    };
+
+    static producer_cache& thread_cache()
+    {
+        static SPDLOG_THREAD_LOCAL producer_cache cache;
+        return cache;
+    }
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+    // visual studio 2013 supports thread local storage of POD types only
+    static void track_ring(const std::shared_ptr<producer_ring>&)
+    {}
+#else
+    // marks the rings of the thread abandoned when it exits
+    struct ring_owner
+    {
+        std::vector<std::weak_ptr<producer_ring>> rings;
+
+        ~ring_owner()
+        {
+            auto& cache = thread_cache();
+            delete[] cache.entries;
+            cache = producer_cache();
+            cache.exited = true;
+            for (auto& r : rings)
+            {
+                if (auto ring = r.lock())
+                    ring->abandoned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    static void track_ring(const std::shared_ptr<producer_ring>& ring)
+    {
+        static thread_local ring_owner owner;
+        // forget the rings of destroyed queues
+        owner.rings.erase(std::remove_if(owner.rings.begin(), owner.rings.end(), [](const std::weak_ptr<producer_ring>& r)
+        {
+            return r.expired();
+        }), owner.rings.end());
+        owner.rings.push_back(ring);
+    }
+#endif
+
+    // unique id per queue, so the thread local ring cache is never fooled by a recycled queue address or slot
+    static size_t next_id()
+    {
+        static std::atomic<size_t> id(0);
+        return ++id;
+    }
+
+    // slots of the live queues, the lowest free one is taken first.
+    // never destroyed, so queues can be destroyed at exit (e.g. by the registry)
+    static std::mutex& slots_mutex()
+    {
+        static std::mutex* mutex = new std::mutex();
+        return *mutex;
+    }
+
+    static std::vector<bool>& used_slots()
+    {
+        static std::vector<bool>* slots = new std::vector<bool>();
+        return *slots;
+    }
+
+    static size_t acquire_slot()
+    {
+        std::lock_guard<std::mutex> lock(slots_mutex());
+        auto& slots = used_slots();
+        auto slot = static_cast<size_t>(std::find(slots.begin(), slots.end(), false) - slots.begin());
+        if (slot == slots.size())
+            slots.push_back(true);
+        else
+            slots[slot] = true;
+        return slot;
+    }
+
+    static void release_slot(size_t slot)
+    {
+        std::lock_guard<std::mutex> lock(slots_mutex());
+        used_slots()[slot] = false;
+    }
+
+    // the calling thread's ring, null if the thread is exiting
+    ring_type* thread_ring()
+    {
+        auto& cache = thread_cache();
+        if (_slot < cache.capacity && cache.entries[_slot].queue_id == _id)
+            return cache.entries[_slot].ring;
+        if (cache.exited)
+            return nullptr;
+
+        ring_type* ring = register_producer();
+        if (_slot >= cache.capacity)
+            grow_cache(cache, _slot + 1);
+        cache.entries[_slot] = { _id, ring };
+        return ring;
+    }
+
+    static void grow_cache(producer_cache& cache, size_t min_capacity)
+    {
+        auto capacity = (std::max)(min_capacity, (std::max)(cache.capacity * 2, static_cast<size_t>(8)));
+        auto entries = new typename producer_cache::entry[capacity]();
+        std::copy(cache.entries, cache.entries + cache.capacity, entries);
+        delete[] cache.entries;
+        cache.entries = entries;
+        cache.capacity = capacity;
+    }
+
+    ring_type* register_producer()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto& ring = _rings[std::this_thread::get_id()];
+        // the thread id of an exited thread can be recycled. its abandoned ring is freed once drained
+        if (!ring || ring->abandoned.load(std::memory_order_acquire))
+        {
+            ring = std::make_shared<producer_ring>(_ring_size, std::this_thread::get_id());
+            _all_rings.push_back(ring);
+            track_ring(ring);
+            _rings_version.fetch_add(1, std::memory_order_release);
+        }
+        return &ring->ring;
+    }
+
+    void refresh_consumer_rings()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        update_consumer_rings();
+    }
+
+    // call with the mutex held
+    void update_consumer_rings()
+    {
+        _consumer_rings.clear();
+        for (auto& r : _all_rings)
+            _consumer_rings.push_back(r.get());
+        _consumer_version = _rings_version.load(std::memory_order_relaxed);
+    }
+
+    static bool drained(producer_ring& r)
+    {
+        return r.abandoned.load(std::memory_order_acquire) && !r.ring.front();
+    }
+
+    // free the rings of exited threads once empty. called by the consumer when the queue seems empty
+    void free_abandoned_rings()
+    {
+        bool any_drained = false;
+        for (auto r : _consumer_rings)
+            any_drained = any_drained || drained(*r);
+        if (!any_drained)
+            return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _all_rings.begin(); it != _all_rings.end();)
+        {
+            auto& r = *it;
+            if (!drained(*r))
+            {
+                ++it;
+                continue;
+            }
+            auto found = _rings.find(r->owner);
+            if (found != _rings.end() && found->second == r)
+                _rings.erase(found);
+            _freed_enqueued += r->ring.enqueued_count();
+            it = _all_rings.erase(it);
+        }
+        update_consumer_rings();
+    }
+
+    bool dequeue_next(T& data)
+    {
+        auto ring_count = _consumer_rings.size();
+        for (size_t i = 0; i < ring_count; ++i)
+        {
+            if (_next_ring >= ring_count)
+                _next_ring = 0;
+            if (_consumer_rings[_next_ring++]->ring.dequeue(data))
+                return true;
+        }
+        return false;
+    }
+
+    bool dequeue_oldest(T& data)
+    {
+        ring_type* oldest_ring = nullptr;
+        T* oldest = nullptr;
+        for (auto r : _consumer_rings)
+        {
+            T* item = r->ring.front();
+            if (item && (!oldest || item->time < oldest->time))
+            {
+                oldest = item;
+                oldest_ring = &r->ring;
+            }
+        }
+        if (!oldest)
+            return false;
+        data = std::move(*oldest);
+        oldest_ring->pop();
+        return true;
+    }
+
+    const size_t _id;
+    const size_t _slot;
+    const size_t _ring_size;
+    const bool _timestamp_order;
+
+    // the live ring of each producer thread, and all the rings (including abandoned ones not drained yet)
+    std::mutex _mutex;
+    std::unordered_map<std::thread::id, std::shared_ptr<producer_ring>> _rings;
+    std::vector<std::shared_ptr<producer_ring>> _all_rings;
+    std::atomic<size_t> _rings_version;
+    uint64_t _freed_enqueued; // items enqueued to the freed rings
+
+    // shared by the threads enqueuing while they exit
+    std::mutex _exiting_mutex;
+    std::shared_ptr<producer_ring> _exiting_ring;
+
+    // consumer's snapshot of the rings
+    std::vector<producer_ring*> _consumer_rings;
+    size_t _consumer_version;
+    size_t _next_ring;
+};
+
+} // ns details
+} // ns spdlog
@@ -0,0 +1,235 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+#include "../formatter.h"
+#include "./pattern_formatter_impl.h"
+
+// static_pattern_formatter: the pattern is walked by template recursion at compile time.
+// Every literal char becomes a single store and every flag an inlined write_field<> call into a stack buffer, sized
+// at compile time for the worst case. Unbounded fields (%v, and %n if too long) flush the buffer and are written
+// directly to msg.formatted.
+
+namespace spdlog
+{
+namespace details
+{
+
+// stack buffer of a static pattern being rendered
+struct static_run
+{
+    char* begin;
+    char* p;
+    fmt::MemoryWriter& w;
+
+    void flush()
+    {
+        w << fmt::StringRef(begin, static_cast<size_t>(p - begin));
+        p = begin;
+    }
+};
+
+// a single flag
+template<char Flag, pattern_opcode Code = flag_opcode(Flag), bool Bounded = (max_width(Code) != 0)>
+struct static_flag
+{
+    static const size_t max_size = max_width(Code);
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        run.p = write_field<Code>(run.p, ctx);
+    }
+};
+
+// unbounded source location fields (%@ %g)
+template<char Flag, pattern_opcode Code>
+struct static_flag<Flag, Code, false>
+{
+    static const size_t max_size = 0;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        run.flush();
+        write_source_field<Code>(run.w, ctx.msg);
+    }
+};
+
+// unknown flag - appears as is
+template<char Flag>
+struct static_flag<Flag, pattern_opcode::literal, false>
+{
+    static const size_t max_size = 2;
+
+    static void write(static_run& run, const format_context&)
+    {
+        *run.p++ = '%';
+        *run.p++ = Flag;
+    }
+};
+
+template<char Flag>
+struct static_flag<Flag, pattern_opcode::text, false>
+{
+    static const size_t max_size = 0;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        run.flush();
+        run.w << fmt::StringRef(ctx.msg.raw.data(), ctx.msg.raw.size());
+    }
+};
+
+// string fields written into the run if short enough (%n %s %!)
+template<pattern_opcode Code>
+struct static_run_str
+{
+    static const size_t max_size = max_name_size;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        run.p = write_run_str(run.begin, run.p, run.w, run_str<Code>(ctx.msg));
+    }
+};
+
+template<char Flag>
+struct static_flag<Flag, pattern_opcode::name, true> : static_run_str<pattern_opcode::name>
+{};
+
+template<char Flag>
+struct static_flag<Flag, pattern_opcode::source_basename, true> : static_run_str<pattern_opcode::source_basename>
+{};
+
+template<char Flag>
+struct static_flag<Flag, pattern_opcode::source_funcname, true> : static_run_str<pattern_opcode::source_funcname>
+{};
+
+// the pattern from position I on.
+// C is the current char and Flag the one following it if C is a % sign.
+template<typename Pattern, size_t I = 0, char C = Pattern::value()[I], char Flag = (C == '%' ? Pattern::value()[I + 1] : '\0')>
+struct static_pattern_step
+{
+    typedef static_pattern_step<Pattern, I + 1> next;
+    static const size_t max_size = 1 + next::max_size;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        *run.p++ = C;
+        next::write(run, ctx);
+    }
+};
+
+// end of pattern (a trailing % sign is ignored, as in pattern_formatter)
+template<typename Pattern, size_t I>
+struct static_pattern_step<Pattern, I, '\0', '\0'>
+{
+    static const size_t max_size = 0;
+    static void write(static_run&, const format_context&) {}
+};
+
+template<typename Pattern, size_t I>
+struct static_pattern_step<Pattern, I, '%', '\0'> : static_pattern_step<Pattern, I, '\0', '\0'>
+{};
+
+template<typename Pattern, size_t I, char Flag>
+struct static_pattern_step<Pattern, I, '%', Flag>
+{
+    typedef static_pattern_step<Pattern, I + 2> next;
+    static const size_t max_size = static_flag<Flag>::max_size + next::max_size;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        static_flag<Flag>::write(run, ctx);
+        next::write(run, ctx);
+    }
+};
+
+// %Y, possibly starting one of the iso_sequences
+template<typename Pattern, size_t I, size_t Seq = find_iso_sequence(Pattern::value() + I)>
+struct static_year_step
+{
+    typedef static_pattern_step<Pattern, I + iso_sequences[Seq].size> next;
+    static const size_t max_size = max_width(iso_sequences[Seq].code) + next::max_size;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        run.p = write_field<iso_sequences[Seq].code>(run.p, ctx);
+        next::write(run, ctx);
+    }
+};
+
+template<typename Pattern, size_t I>
+struct static_year_step<Pattern, I, iso_sequence_count>
+{
+    typedef static_pattern_step<Pattern, I + 2> next;
+    static const size_t max_size = static_flag<'Y'>::max_size + next::max_size;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        static_flag<'Y'>::write(run, ctx);
+        next::write(run, ctx);
+    }
+};
+
+template<typename Pattern, size_t I>
+struct static_pattern_step<Pattern, I, '%', 'Y'> : static_year_step<Pattern, I>
+{};
+
+// %+
+template<typename Pattern, size_t I>
+struct static_pattern_step<Pattern, I, '%', '+'>
+{
+    typedef static_pattern_step<full_pattern> full;
+    typedef static_pattern_step<Pattern, I + 2> next;
+    static const size_t max_size = full::max_size + next::max_size;
+
+    static void write(static_run& run, const format_context& ctx)
+    {
+        full::write(run, ctx);
+        next::write(run, ctx);
+    }
+};
+
+}
+}
+
+template<typename Pattern>
+inline void spdlog::static_pattern_formatter<Pattern>::format(details::log_msg& msg)
+{
+    typedef details::static_pattern_step<Pattern> pattern;
+
+    auto t = log_clock::to_time_t(msg.time);
+    const auto& tm_time = details::cached_localtime(t);
+    const details::format_context ctx { msg, t, tm_time, details::cached_tm_digits(t, tm_time) };
+
+    char buf[pattern::max_size + 1];
+    details::static_run run { buf, buf, msg.formatted };
+    pattern::write(run, ctx);
+    run.flush();
+
+    //write eol
+    msg.formatted << details::os::eol();
+}
@@ -0,0 +1,263 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#pragma once
+
+// Clock source reading the cpu time stamp counter (see SPDLOG_CLOCK_TSC in tweakme.h).
+//
+// now() costs an rdtsc instruction and a multiply-add.
+// A background thread re-anchors the counter against the system clock every SPDLOG_TSC_CALIBRATION_MS.
+// Instead of jumping to the system clock at each calibration, the new anchor continues the current conversion and the
+// rate is slewed so the two meet at the next calibration - timestamps stay monotonic and of nanosecond resolution.
+// Only steps larger than max_slew (e.g. the system clock was set) are applied at once.
+//
+// Requires an invariant TSC (checked with cpuid), synchronized between cores (any x86 cpu of the last decade).
+// Other cpus, or x86 cpus without an invariant TSC, get the regular system clock.
+// Until the first calibration (a few millis after the first call), and in a forked child until its own calibration
+// thread measured the counter again, now() returns the system clock as well.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define SPDLOG_TSC_X86
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define SPDLOG_TSC_X86
+#endif
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "../common.h"
+
+#ifndef SPDLOG_TSC_CALIBRATION_MS
+#define SPDLOG_TSC_CALIBRATION_MS 1000
+#endif
+
+namespace spdlog
+{
+namespace details
+{
+
+class tsc_clock
+{
+public:
+    // never destroyed, so it can be used by loggers being destroyed at exit
+    static tsc_clock& instance()
+    {
+        static tsc_clock* clock = new tsc_clock();
+        return *clock;
+    }
+
+    log_clock::time_point now()
+    {
+        if (!_calibrated.load(std::memory_order_acquire))
+        {
+            // the calibration thread is started by the first call, and again in a forked child (threads don't survive fork)
+            if (_invariant_tsc && !_calibrating.exchange(true, std::memory_order_relaxed))
+                std::thread(&tsc_clock::calibrate_loop, this).detach();
+            return log_clock::now();
+        }
+
+        std::uint64_t base_tsc;
+        std::int64_t base_ns;
+        double ns_per_tick;
+        unsigned int seq;
+        do
+        {
+            seq = _seq.load(std::memory_order_acquire);
+            base_tsc = _base_tsc.load(std::memory_order_relaxed);
+            base_ns = _base_ns.load(std::memory_order_relaxed);
+            ns_per_tick = _ns_per_tick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        while ((seq & 1) || seq != _seq.load(std::memory_order_relaxed));
+
+        return to_time_point(to_ns(rdtsc(), base_tsc, base_ns, ns_per_tick));
+    }
+
+    // false while now() returns the system clock
+    bool calibrated() const
+    {
+        return _calibrated.load(std::memory_order_acquire);
+    }
+
+    tsc_clock(const tsc_clock&) = delete;
+    tsc_clock& operator=(const tsc_clock&) = delete;
+
+private:
+    typedef std::chrono::steady_clock steady_clock;
+
+    // clock steps larger than this are applied at once instead of slewed
+    static const std::int64_t max_slew = 10 * 1000 * 1000;
+
+    const bool _invariant_tsc;
+    std::atomic<bool> _calibrating;
+    std::atomic<bool> _calibrated;
+
+    std::atomic<unsigned int> _seq;
+    std::atomic<std::uint64_t> _base_tsc;
+    std::atomic<std::int64_t> _base_ns;
+    std::atomic<double> _ns_per_tick;
+
+    // start of the long term rate measurement (against the steady clock, which is not subject to clock steps)
+    std::uint64_t _start_tsc;
+    steady_clock::time_point _start_steady;
+
+    tsc_clock():
+        _invariant_tsc(has_invariant_tsc()),
+        _calibrating(false),
+        _calibrated(false),
+        _seq(0),
+        _base_tsc(0),
+        _base_ns(0),
+        _ns_per_tick(0)
+    {
+        _start_steady = steady_clock::now();
+        _start_tsc = rdtsc();
+#ifndef _WIN32
+        if (_invariant_tsc)
+            ::pthread_atfork(nullptr, nullptr, &tsc_clock::on_fork_child);
+#endif
+    }
+
+    // the child has no calibration thread. without it the slewed rate would drift away from the system clock
+    static void on_fork_child()
+    {
+        auto& clock = instance();
+        clock._calibrated.store(false, std::memory_order_relaxed);
+        clock._calibrating.store(false, std::memory_order_relaxed);
+        // the fork may have interrupted a calibration in the middle of its update
+        clock._seq.store(0, std::memory_order_relaxed);
+    }
+
+    static bool has_invariant_tsc()
+    {
+        // cpuid 0x80000007, edx bit 8
+#if defined(_M_X64) || defined(_M_IX86)
+        int regs[4];
+        __cpuid(regs, 0x80000000);
+        if (static_cast<unsigned int>(regs[0]) < 0x80000007)
+            return false;
+        __cpuid(regs, 0x80000007);
+        return (regs[3] & (1 << 8)) != 0;
+#elif defined(SPDLOG_TSC_X86)
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+            return false;
+        return (edx & (1 << 8)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    static std::uint64_t rdtsc()
+    {
+#ifdef SPDLOG_TSC_X86
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    static std::int64_t system_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(log_clock::now().time_since_epoch()).count();
+    }
+
+    static std::int64_t to_ns(std::uint64_t tsc, std::uint64_t base_tsc, std::int64_t base_ns, double ns_per_tick)
+    {
+        // the tsc may be read by a core slightly behind the one which anchored it
+        auto ticks = static_cast<double>(static_cast<std::int64_t>(tsc - base_tsc));
+        return base_ns + static_cast<std::int64_t>(ticks * ns_per_tick);
+    }
+
+    static log_clock::time_point to_time_point(std::int64_t ns)
+    {
+        return log_clock::time_point(std::chrono::duration_cast<log_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+    double measured_ns_per_tick(std::uint64_t tsc, steady_clock::time_point steady) const
+    {
+        auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(steady - _start_steady).count();
+        return static_cast<double>(elapsed_ns) / static_cast<double>(tsc - _start_tsc);
+    }
+
+    void calibrate_loop()
+    {
+        // initial rate, measured over 10 millis at least (good to a few ppm, refined by the next calibrations).
+        // first anchor at the system clock, which now() returned until then
+        const auto initial_period = std::chrono::milliseconds(10);
+        if (steady_clock::now() < _start_steady + initial_period)
+            std::this_thread::sleep_for(initial_period);
+        auto steady = steady_clock::now();
+        auto tsc = rdtsc();
+        store_anchor(tsc, system_ns(), measured_ns_per_tick(tsc, steady));
+        _calibrated.store(true, std::memory_order_release);
+
+        const std::int64_t interval_ns = SPDLOG_TSC_CALIBRATION_MS * 1000000LL;
+        for (;;)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SPDLOG_TSC_CALIBRATION_MS));
+            calibrate(interval_ns);
+        }
+    }
+
+    void calibrate(std::int64_t interval_ns)
+    {
+        auto steady = steady_clock::now();
+        auto tsc = rdtsc();
+        auto real_ns = system_ns();
+
+        auto rate = measured_ns_per_tick(tsc, steady);
+        auto current_ns = to_ns(tsc, _base_tsc.load(std::memory_order_relaxed), _base_ns.load(std::memory_order_relaxed),
+                                _ns_per_tick.load(std::memory_order_relaxed));
+        auto error = real_ns - current_ns;
+
+        if (error > max_slew || error < -max_slew)
+            store_anchor(tsc, real_ns, rate);
+        else // continue from the current reading and catch up by the next calibration
+            store_anchor(tsc, current_ns, rate * static_cast<double>(interval_ns + error) / static_cast<double>(interval_ns));
+    }
+
+    void store_anchor(std::uint64_t tsc, std::int64_t base_ns, double ns_per_tick)
+    {
+        // seqlock write: readers retry while _seq is odd or has changed
+        _seq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _base_tsc.store(tsc, std::memory_order_relaxed);
+        _base_ns.store(base_ns, std::memory_order_relaxed);
+        _ns_per_tick.store(ns_per_tick, std::memory_order_relaxed);
+        _seq.fetch_add(1, std::memory_order_release);
+    }
+};
+
+}
+}
@@ -28,7 +28,15 @@ namespace spdlog
 {
 namespace details
 {
-class flag_formatter;
+enum class pattern_opcode : unsigned char;
+
+// a single instruction of a compiled pattern (see pattern_formatter_impl.h)
+struct pattern_op
+{
+    pattern_opcode code;
+    unsigned int offset;
+    unsigned int size;
+};
 }
 
 class formatter
@@ -48,11 +56,38 @@ public:
     void format(details::log_msg& msg) override;
 private:
     const std::string _pattern;
-    std::vector<std::unique_ptr<details::flag_formatter>> _formatters;
-    void handle_flag(char flag);
-    void compile_pattern(const std::string& pattern);
+    std::vector<details::pattern_op> _ops;
+    std::string _literals;
+    void handle_flag(char flag, std::string& user_chars);
+    void compile_pattern(const std::string& pattern, std::string& user_chars);
+    void add_literal(std::string& user_chars);
+    void add_op(details::pattern_opcode code, std::string& user_chars);
+    void merge_runs();
+};
+
+//
+// Formatter for a pattern known at compile time.
+// The pattern is given by a type with a static constexpr value() function returning it (see SPDLOG_STATIC_PATTERN),
+// and is expanded at compile time into an inlined sequence of field writers - no parsing or dispatch per message.
+// Supports the same flags and produces the same output as pattern_formatter.
+// Requires constexpr support (not available under visual studio 2013).
+//
+// Usage:
+//   SPDLOG_STATIC_PATTERN(my_pattern, "[%H:%M:%S.%e] [%l] %v");
+//   logger->set_formatter(std::make_shared<spdlog::static_pattern_formatter<my_pattern>>());
+//
+template<typename Pattern>
+class static_pattern_formatter : public formatter
+{
+public:
+    void format(details::log_msg& msg) override;
 };
 }
 
+// define a pattern type named name for static_pattern_formatter
+#define SPDLOG_STATIC_PATTERN(name, pattern) \
+    struct name { static SPDLOG_CONSTEXPR const char* value() { return pattern; } }
+
 #include "details/pattern_formatter_impl.h"
+#include "details/static_pattern_formatter_impl.h"
 
@@ -103,6 +103,10 @@ public:
     template <typename... Args>
     details::line_logger force_log(level::level_enum lvl, const char* fmt, const Args&... args);
 
+    // Same, with the message's source location (static, as set by the SPDLOG_LOGGER_* macros)
+    template <typename... Args>
+    details::line_logger force_log(const source_loc* source, level::level_enum lvl, const char* fmt, const Args&... args);
+
     // Set the format of the log messages from this logger
     void set_pattern(const std::string&);
     void set_formatter(formatter_ptr);
@@ -113,6 +117,7 @@ protected:
     virtual void _log_msg(details::log_msg&);
     virtual void _set_pattern(const std::string&);
     virtual void _set_formatter(formatter_ptr);
+    virtual void _flush();
     details::line_logger _log_if_enabled(level::level_enum lvl);
     template <typename... Args>
     details::line_logger _log_if_enabled(level::level_enum lvl, const char* fmt, const Args&... args);
@@ -125,6 +130,8 @@ protected:
     std::vector<sink_ptr> _sinks;
     formatter_ptr _formatter;
     std::atomic_int _level;
+    // let the line_logger defer the formatting of arithmetic-only args to _log_msg()
+    bool _deferred_format;
 
 };
 }
@@ -25,7 +25,7 @@
 #pragma once
 //
 // base sink templated over a mutex (either dummy or realy)
-// concrete implementation should only overrid the _sink_it method.
+// concrete implementation should only overrid the _sink_it method (and optionally _sink_batch).
 // all locking is taken care of here so no locking needed by the implementors..
 //
 
@@ -58,8 +58,21 @@ public:
         _sink_it(msg);
     }
 
+    void log_batch(const details::log_batch& batch) override
+    {
+        std::lock_guard<Mutex> lock(_mutex);
+        _sink_batch(batch);
+    }
+
 protected:
     virtual void _sink_it(const details::log_msg& msg) = 0;
+
+    // called with the mutex held. override to write the batch more efficiently than message by message
+    virtual void _sink_batch(const details::log_batch& batch)
+    {
+        for (auto& msg : batch)
+            _sink_it(msg);
+    }
     Mutex _mutex;
 };
 }
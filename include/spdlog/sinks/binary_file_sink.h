@@ -0,0 +1,106 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#pragma once
+
+#include <mutex>
+#include "base_sink.h"
+#include "../details/null_mutex.h"
+#include "../details/file_helper.h"
+#include "../details/binary_log.h"
+
+namespace spdlog
+{
+namespace sinks
+{
+/*
+* File sink writing the messages in the binary log format (see details/binary_log.h) instead of formatting them.
+* Decode the file with tools/binlog_decode, which renders the messages with any pattern.
+* Appends a new session to an existing file.
+*/
+template<class Mutex>
+class binary_file_sink : public base_sink < Mutex >
+{
+public:
+    explicit binary_file_sink(const std::string &filename,
+                              bool force_flush = false) :
+        _file_helper(force_flush)
+    {
+        _file_helper.open(filename);
+        _writer.write_header();
+        _write_buffer();
+    }
+
+    void flush() override
+    {
+        _file_helper.flush();
+    }
+
+    bool needs_formatted() const override
+    {
+        return false;
+    }
+
+    bool accepts_deferred() const override
+    {
+        return true;
+    }
+
+protected:
+    void _sink_it(const details::log_msg& msg) override
+    {
+        _writer.write(msg);
+        _write_buffer();
+    }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        for (auto& msg : batch)
+            _writer.write(msg);
+        _write_buffer();
+    }
+
+private:
+    void _write_buffer()
+    {
+        try
+        {
+            _file_helper.write(_writer.data(), _writer.size());
+        }
+        catch (...)
+        {
+            _writer.clear();
+            throw;
+        }
+        _writer.clear();
+    }
+
+    details::file_helper _file_helper;
+    details::binary_log::writer _writer;
+};
+
+typedef binary_file_sink<std::mutex> binary_file_sink_mt;
+typedef binary_file_sink<details::null_mutex> binary_file_sink_st;
+}
+}
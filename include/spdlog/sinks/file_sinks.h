@@ -57,6 +57,11 @@ protected:
     {
         _file_helper.write(msg);
     }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        _file_helper.write(batch);
+    }
 private:
     details::file_helper _file_helper;
 };
@@ -101,6 +106,15 @@ protected:
         _file_helper.write(msg);
     }
 
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        // if the batch would cross the size limit, rotate at the exact message
+        if (_current_size + batch.formatted.size() > _max_size)
+            return base_sink<Mutex>::_sink_batch(batch);
+        _current_size += batch.formatted.size();
+        _file_helper.write(batch);
+    }
+
 private:
     static std::string calc_filename(const std::string& filename, std::size_t index, const std::string& extension)
     {
@@ -183,16 +197,27 @@ public:
 
 protected:
     void _sink_it(const details::log_msg& msg) override
+    {
+        _rotate_if_needed();
+        _file_helper.write(msg);
+    }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        _rotate_if_needed();
+        _file_helper.write(batch);
+    }
+
+private:
+    void _rotate_if_needed()
     {
         if (std::chrono::system_clock::now() >= _rotation_tp)
         {
             _file_helper.open(calc_filename(_base_filename, _extension));
             _rotation_tp = _next_rotation_tp();
         }
-        _file_helper.write(msg);
     }
 
-private:
     std::chrono::system_clock::time_point _next_rotation_tp()
     {
         using namespace std::chrono;
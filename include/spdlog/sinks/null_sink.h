@@ -43,6 +43,11 @@ protected:
     void flush() override
     {}
 
+    bool needs_formatted() const override
+    {
+        return false;
+    }
+
 };
 typedef null_sink<details::null_mutex> null_sink_st;
 typedef null_sink<std::mutex> null_sink_mt;
@@ -24,7 +24,10 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
 #include "../details/log_msg.h"
+#include "../formatter.h"
 
 namespace spdlog
 {
@@ -35,8 +38,99 @@ class sink
 public:
     virtual ~sink() {}
     virtual void log(const details::log_msg& msg) = 0;
+
+    // log consecutive formatted messages. sinks which can write the whole batch at once should override it
+    virtual void log_batch(const details::log_batch& batch)
+    {
+        for (auto& msg : batch)
+            log(msg);
+    }
+
     virtual void flush() = 0;
+
+    // whether the sink reads the formatted text of the messages (msg.formatted, batch.formatted).
+    // sinks that use only the raw fields should return false: a formatter runs only if some sink it serves needs it,
+    // otherwise the formatted text of their messages is empty or left over from other sinks.
+    virtual bool needs_formatted() const
+    {
+        return true;
+    }
+
+    // whether the sink takes messages whose deferred format args (msg.deferred) are not rendered into msg.raw yet.
+    // the async worker renders them only if some sink of the logger does not.
+    virtual bool accepts_deferred() const
+    {
+        return false;
+    }
+
+    // Set the format of the messages of this sink, instead of the logger's one.
+    // Sinks of a logger sharing the same formatter object get the message formatted once for all of them.
+    // Like the logger's, not to be changed while logging to the sink.
+    void set_pattern(const std::string& pattern)
+    {
+        _formatter = std::make_shared<pattern_formatter>(pattern);
+    }
+
+    void set_formatter(formatter_ptr msg_formatter)
+    {
+        _formatter = msg_formatter;
+    }
+
+    // null if the sink uses the logger's formatter
+    const formatter_ptr& get_formatter() const
+    {
+        return _formatter;
+    }
+
+private:
+    formatter_ptr _formatter;
 };
 }
+
+namespace details
+{
+// the formatter of the sink's messages
+inline formatter* sink_formatter(const sinks::sink& sink, formatter* logger_formatter)
+{
+    auto& own_formatter = sink.get_formatter();
+    return own_formatter ? own_formatter.get() : logger_formatter;
+}
+
+// whether the sink at index i is the first one using its formatter, i.e. the one its group of sinks is served from
+inline bool first_of_formatter_group(const std::vector<sink_ptr>& sinks, size_t i, formatter* logger_formatter)
+{
+    auto group_formatter = sink_formatter(*sinks[i], logger_formatter);
+    for (size_t j = 0; j < i; ++j)
+        if (sink_formatter(*sinks[j], logger_formatter) == group_formatter)
+            return false;
+    return true;
+}
+
+// log the message to the sinks, formatted once per distinct formatter and only for the groups having a sink that needs it
+inline void log_to_sinks(log_msg& msg, const std::vector<sink_ptr>& sinks, formatter* logger_formatter)
+{
+    for (size_t i = 0; i < sinks.size(); ++i)
+    {
+        if (!first_of_formatter_group(sinks, i, logger_formatter))
+            continue;
+
+        auto group_formatter = sink_formatter(*sinks[i], logger_formatter);
+        bool formatted = false;
+        for (size_t j = i; j < sinks.size(); ++j)
+        {
+            auto& sink = sinks[j];
+            if (sink_formatter(*sink, logger_formatter) != group_formatter)
+                continue;
+            if (!formatted && sink->needs_formatted())
+            {
+                msg.formatted.clear();
+                group_formatter->format(msg);
+                formatted = true;
+            }
+            sink->log(msg);
+        }
+    }
+}
+}
 }
 
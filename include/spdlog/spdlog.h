@@ -31,6 +31,7 @@
 #include "tweakme.h"
 #include "common.h"
 #include "logger.h"
+#include "details/log_sampling.h"
 
 namespace spdlog
 {
@@ -64,11 +65,40 @@ void set_level(level::level_enum log_level);
 // async_overflow_policy (optional, block_retry by default):
 //    async_overflow_policy::block_retry - if queue is full, block until queue has room for the new log entry.
 //    async_overflow_policy::discard_log_msg - never block and discard any new messages when queue  overflows.
+//    async_overflow_policy::discard_by_level - discard trace/debug/info messages when the queue is above SPDLOG_ASYNC_DROP_WATERMARK percent,
+//                                              discard notice/warn messages when the queue is full, block for err and above.
+//                                              a "dropped N messages since T" warning is logged once the worker catches up.
 //
 // worker_warmup_cb (optional):
-//     callback function that will be called in worker thread upon start (can be used to init stuff like thread affinity)
+//     callback function that will be called in each worker thread upon start (can be used to init stuff like thread affinity).
+//     either void() or void(size_t worker_index).
 //
-void set_async_mode(size_t queue_size, const async_overflow_policy overflow_policy = async_overflow_policy::block_retry, const std::function<void()>& worker_warmup_cb = nullptr, const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero());
+// flush_interval_ms (optional):
+//     flush the sinks periodically (zero by default - no periodic flush)
+//
+// queue_type (optional, mpmc by default):
+//    async_queue_type::mpmc - all producer threads share a single lockfree queue.
+//    async_queue_type::spsc_round_robin - each producer thread gets its own wait-free queue of queue_size entries (no contention between producers).
+//    async_queue_type::spsc_timestamp - same, but messages from different threads are logged by their time.
+//    with the spsc types, every producer thread costs a queue of queue_size entries (about 336 bytes each),
+//    which is freed once the thread exited and its messages were logged.
+//
+// wait_strategy (optional, backoff by default):
+//    async_wait_strategy::busy_spin - the worker thread polls the queue nonstop (lowest latency, uses a full core).
+//    async_wait_strategy::backoff - the worker thread spins, yields and then sleeps up to 100ms when the queue is idle.
+//    async_wait_strategy::blocking - the worker thread sleeps until a message arrives (no cpu usage when idle).
+//
+// worker_threads (optional, 1 by default):
+//    number of worker threads per logger, each with its own queue of queue_size entries.
+//    sinks are spread over the workers (sink i is served by worker i % worker_threads), so slow sinks don't hold back the others.
+//    at most one worker per sink is started.
+//
+// shared_pool (optional, false by default):
+//    if true, all async loggers created by spdlog share a single pool of worker_threads workers (each with its queue of queue_size entries),
+//    so the number of threads and the memory used don't grow with the number of loggers.
+//    each logger keeps its own sinks and formatter.
+//
+void set_async_mode(size_t queue_size, const async_overflow_policy overflow_policy = async_overflow_policy::block_retry, const worker_warmup_callback& worker_warmup_cb = nullptr, const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(), const async_queue_type queue_type = async_queue_type::mpmc, const async_wait_strategy wait_strategy = async_wait_strategy::backoff, size_t worker_threads = 1, bool shared_pool = false);
 
 // Turn off async mode
 void set_sync_mode();
@@ -136,19 +166,152 @@ void drop_all();
 // SPDLOG_DEBUG(my_logger, "Some debug message {} {}", 1, 3.2);
 ///////////////////////////////////////////////////////////////////////////////
 
+// " (file #line)" as a single literal, appended with one write
+#define SPDLOG_STRINGIFY_(x) #x
+#define SPDLOG_STRINGIFY(x) SPDLOG_STRINGIFY_(x)
+#define SPDLOG_SOURCE_SUFFIX " (" __FILE__ " #" SPDLOG_STRINGIFY(__LINE__) ")"
+
 #ifdef SPDLOG_TRACE_ON
-#define SPDLOG_TRACE(logger, ...) logger->trace(__VA_ARGS__) << " (" << __FILE__ << " #" << __LINE__ <<")";
+#define SPDLOG_TRACE(logger, ...) logger->trace(__VA_ARGS__) << SPDLOG_SOURCE_SUFFIX;
 #else
 #define SPDLOG_TRACE(logger, ...)
 #endif
 
 #ifdef SPDLOG_DEBUG_ON
-#define SPDLOG_DEBUG(logger, ...) logger->debug(__VA_ARGS__)  << " (" << __FILE__ << " #" << __LINE__ <<")";
+#define SPDLOG_DEBUG(logger, ...) logger->debug(__VA_ARGS__) << SPDLOG_SOURCE_SUFFIX;
 #else
 #define SPDLOG_DEBUG(logger, ...)
 #endif
 
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Level checked logging macros. The arguments are evaluated only if the logger
+// logs the given level, so disabled calls cost just the level check.
+// logger can be a pointer or a shared pointer, and is evaluated once.
+// The call site's file, line, function, level and format string are kept in a static source_loc
+// (see log_msg::source), for the %@ %s %g %# %! pattern flags.
+//
+// Calls below SPDLOG_ACTIVE_LEVEL (see tweakme.h) are compiled out entirely.
+//
+// Example:
+// SPDLOG_LOGGER_DEBUG(my_logger, "Expensive to compute: {}", compute_something());
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPDLOG_ACTIVE_LEVEL
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+// the first of the macro args (the format string)
+#define SPDLOG_EXPAND(x) x
+#define SPDLOG_FIRST_ARG_(first, ...) first
+#define SPDLOG_FIRST_ARG(...) SPDLOG_EXPAND(SPDLOG_FIRST_ARG_(__VA_ARGS__, ""))
+
+// lvl must be a constant (it is part of the call site's static metadata)
+#define SPDLOG_LOGGER_LOG(logger, lvl, ...) \
+    do { \
+        static const spdlog::source_loc spdlog_source_ { __FILE__, __LINE__, SPDLOG_FUNCTION, lvl, \
+            spdlog::details::literal_fmt(SPDLOG_FIRST_ARG(__VA_ARGS__)), { 0 } }; \
+        auto&& spdlog_logger_ = (logger); \
+        if (spdlog_logger_->should_log(lvl)) \
+            spdlog_logger_->force_log(&spdlog_source_, lvl, __VA_ARGS__); \
+    } while (0)
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define SPDLOG_LOGGER_TRACE(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::trace, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_TRACE(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define SPDLOG_LOGGER_DEBUG(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::debug, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_DEBUG(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#define SPDLOG_LOGGER_INFO(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::info, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_INFO(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_NOTICE
+#define SPDLOG_LOGGER_NOTICE(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::notice, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_NOTICE(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define SPDLOG_LOGGER_WARN(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::warn, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_WARN(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+#define SPDLOG_LOGGER_ERROR(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::err, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_ERROR(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_CRITICAL
+#define SPDLOG_LOGGER_CRITICAL(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::critical, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_CRITICAL(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ALERT
+#define SPDLOG_LOGGER_ALERT(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::alert, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_ALERT(logger, ...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_EMERG
+#define SPDLOG_LOGGER_EMERG(logger, ...) SPDLOG_LOGGER_LOG(logger, spdlog::level::emerg, __VA_ARGS__)
+#else
+#define SPDLOG_LOGGER_EMERG(logger, ...) (void)0
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Rate limited and sampled logging, per call site (see details/log_sampling.h).
+// The suppressed messages of a site are counted, and the next message it logs
+// ends with " [N similar messages suppressed]".
+// Like SPDLOG_LOGGER_LOG, lvl must be a constant. Levels below SPDLOG_ACTIVE_LEVEL are optimized out.
+//
+// Examples:
+// SPDLOG_LOGGER_RATE_LIMITED(my_logger, spdlog::level::warn, 10, "queue full, dropped {}", id); // at most 10 per second
+// SPDLOG_LOGGER_SAMPLED(my_logger, spdlog::level::info, 0, 1000, "progress {}", i); // 1 in 1000
+// SPDLOG_LOGGER_SAMPLED(my_logger, spdlog::level::err, 5, 100, "retrying {}", i); // first 5, then every 100th
+///////////////////////////////////////////////////////////////////////////////
+
+#define SPDLOG_LOGGER_LIMITED_(logger, lvl, limiter, ...) \
+    do { \
+        static const spdlog::source_loc spdlog_source_ { __FILE__, __LINE__, SPDLOG_FUNCTION, lvl, \
+            spdlog::details::literal_fmt(SPDLOG_FIRST_ARG(__VA_ARGS__)), { 0 } }; \
+        auto&& spdlog_logger_ = (logger); \
+        if ((lvl) >= SPDLOG_ACTIVE_LEVEL && spdlog_logger_->should_log(lvl) && (limiter).allow()) \
+        { \
+            auto spdlog_suppressed_ = (limiter).take_suppressed(); \
+            auto spdlog_line_ = spdlog_logger_->force_log(&spdlog_source_, lvl, __VA_ARGS__); \
+            if (spdlog_suppressed_) \
+                spdlog_line_ << " [" << spdlog_suppressed_ << " similar messages suppressed]"; \
+        } \
+    } while (0)
+
+#define SPDLOG_LOGGER_RATE_LIMITED(logger, lvl, max_per_second, ...) \
+    do { \
+        static spdlog::details::rate_limiter spdlog_limiter_(max_per_second); \
+        SPDLOG_LOGGER_LIMITED_(logger, lvl, spdlog_limiter_, __VA_ARGS__); \
+    } while (0)
+
+#define SPDLOG_LOGGER_SAMPLED(logger, lvl, first, every, ...) \
+    do { \
+        static spdlog::details::log_sampler spdlog_limiter_(first, every); \
+        SPDLOG_LOGGER_LIMITED_(logger, lvl, spdlog_limiter_, __VA_ARGS__); \
+    } while (0)
+
+
 }
 
 
@@ -38,6 +38,17 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Under x86/x64 cpus with an invariant TSC, the time stamp counter can be used as the clock instead.
+// Cheaper than the regular clock while keeping nanosecond resolution: a background thread
+// calibrates it against the system clock every SPDLOG_TSC_CALIBRATION_MS (default 1000) millis.
+// Other cpus keep the regular clock. Forked children start their own calibration thread.
+// Uncomment to use it instead of the regular clock (takes precedence over SPDLOG_CLOCK_COARSE).
+// #define SPDLOG_CLOCK_TSC
+// #define SPDLOG_TSC_CALIBRATION_MS 1000
+///////////////////////////////////////////////////////////////////////////////
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment if date/time logging is not needed.
 // This will prevent spdlog from quering the clock on each log call.
@@ -52,6 +63,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to log small sequential thread ids (1, 2, 3.. in the order threads first log)
+// in %t instead of the os thread ids.
+// #define SPDLOG_LOGICAL_THREAD_ID
+///////////////////////////////////////////////////////////////////////////////
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment if logger name logging is not needed.
 // This will prevent spdlog from copying the logger name  on each log call.
@@ -59,6 +77,46 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to let async loggers format messages in the worker thread instead of the caller's thread.
+// Applies to logger.info(fmt, args..) calls whose args are all arithmetic types (up to 8 args).
+// The format string is copied into the queue slot, messages whose format string does not fit there are formatted right away.
+// Messages of the SPDLOG_LOGGER_* macros refer to their call site's format string instead, and binary file sinks
+// store their args as they are: such messages are formatted by binlog_decode, if only binary sinks log them.
+// Formatting errors in such calls are reported in the logged text instead of throwing spdlog_ex.
+// #define SPDLOG_ASYNC_DEFERRED_FORMAT
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Size of the text buffers stored inline in each log_msg (default 500 bytes).
+// Each thread recycles its log_msg, whose buffers keep the capacity grown by long messages,
+// so a smaller size mostly saves memory (it applies to all fmt::MemoryWriters).
+// #define SPDLOG_LOG_MSG_INLINE_SIZE 500
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Size of the text buffer stored inline in each async queue slot (default 256 bytes).
+// Longer messages need an additional heap allocation per message.
+// Each async logger pre-allocates queue_size slots of about this size.
+// #define SPDLOG_ASYNC_MSG_INLINE_SIZE 256
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Max number of messages the async worker drains from the queue and hands to the sinks at once (default 64).
+// File sinks write each batch with a single write call.
+// #define SPDLOG_ASYNC_BATCH_SIZE 64
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queue fill percentage above which async_overflow_policy::discard_by_level drops trace/debug/info messages (default 75).
+// #define SPDLOG_ASYNC_DROP_WATERMARK 75
+///////////////////////////////////////////////////////////////////////////////
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment to enable the SPDLOG_DEBUG/SPDLOG_TRACE macros.
 // #define SPDLOG_DEBUG_ON
@@ -66,6 +124,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Compile out the SPDLOG_LOGGER_TRACE..SPDLOG_LOGGER_EMERG calls below the given level (SPDLOG_LEVEL_TRACE by default).
+// For example, release builds with SPDLOG_LEVEL_INFO carry no trace or debug call sites.
+// #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+///////////////////////////////////////////////////////////////////////////////
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment to avoid locking in the registry operations (spdlog::get(), spdlog::drop() spdlog::register()).
 // Use only if your code never modifes concurrently the registry.
@@ -0,0 +1,648 @@
+#include "includes.h"
+
+// log the given number through an async logger and return the logged text
+template<typename... Args>
+static std::string async_log(const char* fmt, const Args&... args)
+{
+    std::ostringstream oss;
+    {
+        auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+        spdlog::async_logger logger("async_oss", oss_sink, 128);
+        logger.set_pattern("%v");
+        logger.info(fmt, args...);
+    } // logger destruction waits for the queue to drain
+
+    auto eol_size = strlen(spdlog::details::os::eol());
+    return oss.str().substr(0, oss.str().length() - eol_size);
+}
+
+
+TEST_CASE("deferred_args", "[async]")
+{
+    spdlog::details::deferred_args deferred;
+    REQUIRE(deferred.empty());
+    deferred.capture("{} {:.1f} {} {}", 1, 2.25, 'c', true);
+    REQUIRE(!deferred.empty());
+
+    fmt::MemoryWriter w;
+    deferred.render(w);
+    REQUIRE(w.str() == "1 2.2 c true");
+
+    deferred.capture("{} {}", 1);
+    REQUIRE_THROWS_AS(deferred.render(w), spdlog::spdlog_ex);
+}
+
+TEST_CASE("async_format", "[async]")
+{
+    REQUIRE(async_log("Hello") == "Hello");
+    REQUIRE(async_log("Hello {} {}", 1, 2.5) == "Hello 1 2.5");
+    REQUIRE(async_log("Hello {}", std::string("world")) == "Hello world");
+    REQUIRE(async_log("{:08d}", 12) == "00000012");
+}
+
+TEST_CASE("async_long_msg", "[async]")
+{
+    // longer than the queue slot inline buffer
+    std::string long_msg(SPDLOG_ASYNC_MSG_INLINE_SIZE * 3, 'x');
+    REQUIRE(async_log("{}", long_msg) == long_msg);
+    REQUIRE(async_log("{}{}", long_msg, 1) == long_msg + "1");
+}
+
+TEST_CASE("async_queue_types", "[async]")
+{
+    using spdlog::async_queue_type;
+    for (auto queue_type : { async_queue_type::mpmc, async_queue_type::spsc_round_robin, async_queue_type::spsc_timestamp })
+    {
+        const int threads = 4;
+        const int messages = 1000;
+        std::ostringstream oss;
+        {
+            auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+            spdlog::async_logger logger("async_oss", oss_sink, 256, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(), queue_type);
+            logger.set_pattern("%t %v");
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t)
+            {
+                producers.emplace_back([&logger]()
+                {
+                    for (int i = 0; i < messages; ++i)
+                        logger.info("{}", i);
+                });
+            }
+            for (auto& t : producers)
+                t.join();
+        }
+
+        // all messages logged, in order per thread
+        std::istringstream lines(oss.str());
+        std::map<size_t, int> next_msg;
+        size_t thread_id;
+        int msg;
+        int count = 0;
+        while (lines >> thread_id >> msg)
+        {
+            REQUIRE(next_msg[thread_id]++ == msg);
+            ++count;
+        }
+        REQUIRE(count == threads * messages);
+    }
+}
+
+struct queue_item
+{
+    int value;
+    spdlog::log_clock::time_point time;
+};
+
+// enqueues when the thread exits, after the queue's own thread exit hook ran
+struct enqueue_at_exit
+{
+    spdlog::details::per_producer_queue<queue_item>* q = nullptr;
+    ~enqueue_at_exit()
+    {
+        if (q)
+            q->enqueue(queue_item { -1, spdlog::details::os::now() });
+    }
+};
+
+TEST_CASE("per_producer_queue_rings", "[async]")
+{
+    for (bool timestamp_order : { false, true })
+    {
+        spdlog::details::per_producer_queue<queue_item> q(64, timestamp_order);
+        // the ring shared by exiting threads
+        REQUIRE(q.ring_count() == 1);
+
+        const int threads = 10;
+        for (int t = 0; t < threads; ++t)
+        {
+            std::thread([&q]()
+            {
+                static thread_local enqueue_at_exit at_exit;
+                at_exit.q = &q;
+                for (int i = 0; i < 5; ++i)
+                    q.enqueue(queue_item { i, spdlog::details::os::now() });
+            }).join();
+        }
+        REQUIRE(q.ring_count() == 1 + threads);
+
+        // the rings of the exited threads are freed once drained
+        queue_item item;
+        int values = 0, at_exit_values = 0;
+        while (q.dequeue(item))
+            item.value == -1 ? ++at_exit_values : values += item.value;
+        REQUIRE(values == threads * (0 + 1 + 2 + 3 + 4));
+        REQUIRE(at_exit_values == threads);
+        REQUIRE(q.ring_count() == 1);
+
+        // a live producer keeps its ring
+        q.enqueue(queue_item { 1, spdlog::details::os::now() });
+        REQUIRE(q.dequeue(item));
+        REQUIRE(!q.dequeue(item));
+        REQUIRE(q.ring_count() == 2);
+    }
+}
+
+TEST_CASE("per_producer_queue_many_queues", "[async]")
+{
+    // more queues than a producer used to cache, and queues recreated in the slots of destroyed ones
+    typedef spdlog::details::per_producer_queue<queue_item> queue_type;
+    std::vector<std::unique_ptr<queue_type>> queues;
+    for (int i = 0; i < 20; ++i)
+        queues.emplace_back(new queue_type(16, false));
+
+    for (int round = 0; round < 2; ++round)
+    {
+        for (int i = 0; i < 10; ++i)
+            for (auto& q : queues)
+                REQUIRE(q->enqueue(queue_item { i, spdlog::details::os::now() }));
+
+        for (auto& q : queues)
+        {
+            REQUIRE(q->ring_count() == 2);
+            queue_item item;
+            for (int i = 0; i < 10; ++i)
+            {
+                REQUIRE(q->dequeue(item));
+                REQUIRE(item.value == i);
+            }
+            REQUIRE(!q->dequeue(item));
+        }
+
+        for (size_t i = 0; i < queues.size(); i += 2)
+            queues[i].reset(new queue_type(16, false));
+    }
+}
+
+TEST_CASE("async_wait_strategies", "[async]")
+{
+    using spdlog::async_wait_strategy;
+    for (auto wait_strategy : { async_wait_strategy::busy_spin, async_wait_strategy::backoff, async_wait_strategy::blocking })
+    {
+        std::ostringstream oss;
+        {
+            auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+            spdlog::async_logger logger("async_oss", oss_sink, 128, spdlog::async_overflow_policy::block_retry, nullptr,
+                                        std::chrono::milliseconds(5), spdlog::async_queue_type::mpmc, wait_strategy);
+            logger.set_pattern("%v");
+            logger.info("before idle");
+            // let the worker go idle (parked for the blocking strategy) and wake it up again
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            for (int i = 0; i < 1000; ++i)
+                logger.info("{}", i);
+        }
+
+        std::istringstream lines(oss.str());
+        std::string line;
+        std::getline(lines, line);
+        REQUIRE(line == "before idle");
+        int count = 0;
+        while (std::getline(lines, line))
+            REQUIRE(line == std::to_string(count++));
+        REQUIRE(count == 1000);
+    }
+}
+
+// counts the batches it receives and keeps their text
+class batch_counting_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+public:
+    size_t batches = 0;
+    size_t msgs = 0;
+    std::string text;
+
+    void flush() override {}
+
+protected:
+    void _sink_it(const spdlog::details::log_msg& msg) override
+    {
+        ++msgs;
+        text.append(msg.formatted.data(), msg.formatted.size());
+    }
+
+    void _sink_batch(const spdlog::details::log_batch& batch) override
+    {
+        ++batches;
+        msgs += batch.size();
+        text.append(batch.formatted.data(), batch.formatted.size());
+    }
+};
+
+TEST_CASE("async_batch", "[async]")
+{
+    const int messages = 1000;
+    auto sink = std::make_shared<batch_counting_sink>();
+    std::string expected;
+    {
+        spdlog::async_logger logger("async_batch", sink, 1024);
+        logger.set_pattern("%v");
+        for (int i = 0; i < messages; ++i)
+        {
+            logger.info("{}", i);
+            expected += std::to_string(i) + spdlog::details::os::eol();
+        }
+    }
+    REQUIRE(sink->msgs == messages);
+    REQUIRE(sink->batches > 0);
+    REQUIRE(sink->batches <= sink->msgs);
+    REQUIRE(sink->text == expected);
+}
+
+TEST_CASE("async_worker_threads", "[async]")
+{
+    const int messages = 1000;
+    std::ostringstream oss[3];
+    std::mutex warmup_mutex;
+    std::set<size_t> warmup_indices;
+    {
+        std::vector<spdlog::sink_ptr> sinks;
+        for (auto& os : oss)
+            sinks.push_back(std::make_shared<spdlog::sinks::ostream_sink_mt>(os));
+        auto warmup = [&](size_t index)
+        {
+            std::lock_guard<std::mutex> lock(warmup_mutex);
+            warmup_indices.insert(index);
+        };
+        spdlog::async_logger logger("async_oss", sinks.begin(), sinks.end(), 256, spdlog::async_overflow_policy::block_retry, warmup,
+                                    std::chrono::milliseconds::zero(), spdlog::async_queue_type::mpmc, spdlog::async_wait_strategy::backoff, 3);
+        logger.set_pattern("%v");
+        for (int i = 0; i < messages; ++i)
+            logger.info("{}", i);
+    }
+    REQUIRE(warmup_indices == std::set<size_t>({ 0, 1, 2 }));
+
+    // every sink got all messages, in order
+    for (auto& os : oss)
+    {
+        std::istringstream lines(os.str());
+        int msg;
+        int count = 0;
+        while (lines >> msg)
+            REQUIRE(msg == count++);
+        REQUIRE(count == messages);
+    }
+}
+
+// throws when flushed
+struct failing_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+    void _sink_it(const spdlog::details::log_msg&) override
+    {}
+    void flush() override
+    {
+        throw spdlog::spdlog_ex("failing_sink");
+    }
+};
+
+// slow, so its messages are still queued when the other worker thread dies
+struct slow_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+    void _sink_it(const spdlog::details::log_msg&) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        ++count;
+    }
+    void flush() override
+    {}
+    std::atomic<int> count { 0 };
+};
+
+TEST_CASE("async_worker_failure", "[async]")
+{
+    const int messages = 100;
+    auto slow = std::make_shared<slow_sink>();
+    {
+        std::vector<spdlog::sink_ptr> sinks { std::make_shared<failing_sink>(), slow };
+        spdlog::async_logger logger("async_failure", sinks.begin(), sinks.end(), 256, spdlog::async_overflow_policy::block_retry, nullptr,
+                                    std::chrono::milliseconds::zero(), spdlog::async_queue_type::mpmc, spdlog::async_wait_strategy::backoff, 2);
+        for (int i = 0; i < messages; ++i)
+            logger.info("{}", i);
+
+        // the first worker thread dies. its failure is reported once, the other one keeps logging
+        REQUIRE_THROWS_AS(logger.flush(), spdlog::spdlog_ex);
+        logger.flush();
+        REQUIRE(slow->count == messages);
+        for (int i = 0; i < messages; ++i)
+            logger.info("{}", i);
+    } // waits for the live worker thread to log the route's messages before freeing the route
+    REQUIRE(slow->count == 2 * messages);
+}
+
+TEST_CASE("async_warmup_cb_without_index", "[async]")
+{
+    std::atomic<int> calls(0);
+    {
+        spdlog::async_logger logger("async_null", std::make_shared<spdlog::sinks::null_sink_mt>(), 128,
+                                    spdlog::async_overflow_policy::block_retry, [&calls]() { ++calls; });
+        logger.info("test");
+    }
+    REQUIRE(calls == 1);
+}
+
+TEST_CASE("async_shared_pool", "[async]")
+{
+    const int loggers = 10;
+    const int messages = 100;
+    spdlog::drop_all();
+    spdlog::set_async_mode(128, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(),
+                           spdlog::async_queue_type::mpmc, spdlog::async_wait_strategy::backoff, 2, true);
+
+    std::ostringstream oss[loggers];
+    for (int l = 0; l < loggers; ++l)
+    {
+        spdlog::sink_ptr sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss[l]);
+        auto logger = spdlog::create("pool_" + std::to_string(l), { sink });
+        logger->set_pattern("%n %v");
+    }
+    for (int i = 0; i < messages; ++i)
+        for (int l = 0; l < loggers; ++l)
+            spdlog::get("pool_" + std::to_string(l))->info("{}", i);
+
+    // dropping a logger waits for its messages, while the pool keeps serving the other loggers
+    spdlog::drop("pool_0");
+    spdlog::drop_all();
+    spdlog::set_sync_mode();
+
+    for (int l = 0; l < loggers; ++l)
+    {
+        std::istringstream lines(oss[l].str());
+        std::string name;
+        int msg;
+        int count = 0;
+        while (lines >> name >> msg)
+        {
+            REQUIRE(name == "pool_" + std::to_string(l));
+            REQUIRE(msg == count++);
+        }
+        REQUIRE(count == messages);
+    }
+}
+
+// blocks in log() until opened
+class gate_sink : public spdlog::sinks::sink
+{
+public:
+    std::atomic<bool> entered{ false };
+    std::atomic<bool> open{ false };
+    std::string text;
+
+    void log(const spdlog::details::log_msg& msg) override
+    {
+        entered = true;
+        while (!open)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        text.append(msg.formatted.data(), msg.formatted.size());
+    }
+    std::atomic<int> flushes{ 0 };
+    void flush() override
+    {
+        ++flushes;
+    }
+};
+
+TEST_CASE("async_stats", "[async]")
+{
+    auto sink = std::make_shared<gate_sink>();
+    SECTION("dropped")
+    {
+        spdlog::async_logger logger("async_stats", sink, 4, spdlog::async_overflow_policy::discard_log_msg);
+        logger.info("first");
+        while (!sink->entered)
+            std::this_thread::yield();
+        // the worker is stuck on the first message, the queue takes 4 more
+        for (int i = 0; i < 10; ++i)
+            logger.info("msg");
+        auto stats = logger.stats();
+        sink->open = true;
+
+        REQUIRE(stats.queue_depth == 4);
+        REQUIRE(stats.high_water_mark >= 1);
+        REQUIRE(stats.enqueued == 5);
+        REQUIRE(stats.dropped == 6);
+        REQUIRE(stats.total_block_time == std::chrono::nanoseconds::zero());
+    }
+    SECTION("blocked")
+    {
+        spdlog::async_logger logger("async_stats", sink, 4, spdlog::async_overflow_policy::block_retry);
+        logger.info("first");
+        while (!sink->entered)
+            std::this_thread::yield();
+        std::thread opener([&sink]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            sink->open = true;
+        });
+        for (int i = 0; i < 10; ++i)
+            logger.info("msg");
+        opener.join();
+        auto stats = logger.stats();
+
+        REQUIRE(stats.dropped == 0);
+        REQUIRE(stats.enqueued == 11);
+        REQUIRE(stats.max_block_time >= std::chrono::milliseconds(10));
+        REQUIRE(stats.total_block_time >= stats.max_block_time);
+    }
+    SECTION("per_producer")
+    {
+        sink->open = true;
+        spdlog::async_logger logger("async_stats", sink, 64, spdlog::async_overflow_policy::block_retry, nullptr,
+                                    std::chrono::milliseconds::zero(), spdlog::async_queue_type::spsc_round_robin);
+        // counted from the rings, including those of exited threads which were freed
+        for (int round = 0; round < 2; ++round)
+        {
+            for (int t = 0; t < 4; ++t)
+            {
+                std::thread([&logger]()
+                {
+                    for (int i = 0; i < 10; ++i)
+                        logger.info("msg");
+                }).join();
+            }
+        }
+        // the flush token goes into this thread's ring, yet waits for the messages of the other rings
+        logger.flush();
+        REQUIRE(std::count(sink->text.begin(), sink->text.end(), '\n') == 80);
+        auto stats = logger.stats();
+        REQUIRE(stats.queue_depth == 0);
+        REQUIRE(stats.enqueued == 80);
+        REQUIRE(stats.high_water_mark >= 1);
+    }
+}
+
+TEST_CASE("async_discard_by_level", "[async]")
+{
+    auto sink = std::make_shared<gate_sink>();
+    {
+        // watermark at 6 of 8 slots
+        spdlog::async_logger logger("async_discard", sink, 8, spdlog::async_overflow_policy::discard_by_level);
+        logger.set_pattern("%l %v");
+        logger.info("first");
+        while (!sink->entered)
+            std::this_thread::yield();
+        // the worker is stuck on the first message
+        for (int i = 0; i < 10; ++i)
+            logger.info("info {}", i); // 6 fit below the watermark
+        for (int i = 0; i < 3; ++i)
+            logger.warn("warn {}", i); // 2 fit in the rest of the queue
+        REQUIRE(logger.stats().dropped == 5);
+        sink->open = true;
+    }
+
+    std::istringstream lines(sink->text);
+    std::string line;
+    std::vector<std::string> logged;
+    while (std::getline(lines, line))
+        logged.push_back(line);
+    REQUIRE(logged.size() == 10);
+    REQUIRE(logged[0] == "info first");
+    REQUIRE(logged[1].find("warning dropped 5 messages since ") == 0);
+    REQUIRE(logged[2] == "info info 0");
+    REQUIRE(logged[7] == "info info 5");
+    REQUIRE(logged[8] == "warning warn 0");
+    REQUIRE(logged[9] == "warning warn 1");
+}
+
+TEST_CASE("async_drops_reported_without_later_batch", "[async]")
+{
+    // the messages of "dropping" are discarded while the queue is filled by "busy", then "dropping" logs nothing more
+    auto helper = std::make_shared<spdlog::details::async_log_helper>(8, spdlog::async_overflow_policy::discard_by_level);
+    auto busy_sink = std::make_shared<gate_sink>();
+    auto dropping_sink = std::make_shared<gate_sink>();
+    dropping_sink->open = true;
+    std::vector<spdlog::sink_ptr> busy_sinks { busy_sink }, dropping_sinks { dropping_sink };
+    spdlog::async_logger busy("busy", busy_sinks.begin(), busy_sinks.end(), helper);
+    std::unique_ptr<spdlog::async_logger> dropping(new spdlog::async_logger("dropping", dropping_sinks.begin(), dropping_sinks.end(), helper));
+    dropping->set_pattern("%l %v");
+
+    auto drop_some = [&]()
+    {
+        busy_sink->entered = false;
+        busy_sink->open = false;
+        busy.info("first");
+        while (!busy_sink->entered)
+            std::this_thread::yield();
+        // the worker is stuck on the first message, up to the watermark
+        for (int i = 0; i < 6; ++i)
+            busy.info("busy {}", i);
+        for (int i = 0; i < 3; ++i)
+            dropping->info("dropped {}", i);
+        busy_sink->open = true;
+        busy.flush();
+    };
+
+    SECTION("on flush")
+    {
+        drop_some();
+        REQUIRE(dropping_sink->text.empty());
+        dropping->flush();
+        REQUIRE(dropping_sink->text.find("warning dropped 3 messages since ") == 0);
+    }
+    SECTION("on destruction")
+    {
+        drop_some();
+        dropping.reset();
+        REQUIRE(dropping_sink->text.find("warning dropped 3 messages since ") == 0);
+    }
+}
+
+TEST_CASE("async_flush", "[async]")
+{
+    SECTION("file")
+    {
+        std::string filename = "logs/async_flush.txt";
+        std::remove(filename.c_str());
+        auto sink = std::make_shared<spdlog::sinks::simple_file_sink_mt>(filename);
+        spdlog::async_logger logger("async_flush", sink, 1024);
+        logger.set_pattern("%v");
+        for (int i = 0; i < 500; ++i)
+            logger.info("Test message {}", i);
+        logger.flush();
+
+        // everything logged before the flush is in the file
+        std::ifstream ifs(filename);
+        std::string line;
+        int count = 0;
+        while (std::getline(ifs, line))
+            REQUIRE(line == "Test message " + std::to_string(count++));
+        REQUIRE(count == 500);
+    }
+    SECTION("never_discarded")
+    {
+        auto sink = std::make_shared<gate_sink>();
+        spdlog::async_logger logger("async_flush", sink, 4, spdlog::async_overflow_policy::discard_log_msg);
+        logger.info("first");
+        while (!sink->entered)
+            std::this_thread::yield();
+        for (int i = 0; i < 10; ++i)
+            logger.info("msg");
+        // the queue is full, the flush waits for room instead of being discarded
+        std::thread opener([&sink]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            sink->open = true;
+        });
+        logger.flush();
+        opener.join();
+        REQUIRE(sink->flushes == 1);
+        REQUIRE(logger.stats().queue_depth == 0);
+    }
+}
+
+// keeps the raw and formatted text of the messages, needs only the raw one
+struct async_raw_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+    void _sink_it(const spdlog::details::log_msg& msg) override
+    {
+        raw += msg.raw.str();
+        formatted += msg.formatted.str();
+    }
+    void flush() override
+    {}
+    bool needs_formatted() const override
+    {
+        return false;
+    }
+    std::string raw, formatted;
+};
+
+TEST_CASE("async_lazy_formatting", "[async]")
+{
+    auto sink = std::make_shared<async_raw_sink>();
+    {
+        spdlog::async_logger logger("async_raw", sink, 128);
+        for (int i = 0; i < 100; ++i)
+            logger.info("{}", i % 10);
+    }
+    std::string expected;
+    for (int i = 0; i < 100; ++i)
+        expected += std::to_string(i % 10);
+    REQUIRE(sink->raw == expected);
+    REQUIRE(sink->formatted.empty());
+}
+
+TEST_CASE("async_sink_formatters", "[async]")
+{
+    std::ostringstream default_oss, terse_oss1, terse_oss2;
+    auto default_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(default_oss);
+    auto terse_sink1 = std::make_shared<spdlog::sinks::ostream_sink_mt>(terse_oss1);
+    auto terse_sink2 = std::make_shared<spdlog::sinks::ostream_sink_mt>(terse_oss2);
+    auto terse_formatter = std::make_shared<spdlog::pattern_formatter>("%v;");
+    terse_sink1->set_formatter(terse_formatter);
+    terse_sink2->set_formatter(terse_formatter);
+    {
+        spdlog::async_logger logger("async_sink_formatters", { terse_sink1, default_sink, terse_sink2 }, 128);
+        logger.set_pattern("%l %v|");
+        for (int i = 0; i < 50; ++i)
+            logger.info("{}", i);
+    }
+    std::string eol = spdlog::details::os::eol();
+    std::string terse, verbose;
+    for (int i = 0; i < 50; ++i)
+    {
+        terse += std::to_string(i) + ";" + eol;
+        verbose += "info " + std::to_string(i) + "|" + eol;
+    }
+    REQUIRE(default_oss.str() == verbose);
+    REQUIRE(terse_oss1.str() == terse);
+    REQUIRE(terse_oss2.str() == terse);
+}
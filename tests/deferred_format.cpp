@@ -0,0 +1,135 @@
+// Built into its own test binary (see the Makefile): tweaks must be the same in all the translation units of a program.
+#define SPDLOG_ASYNC_DEFERRED_FORMAT
+#include "includes.h"
+#include "../include/spdlog/sinks/binary_file_sink.h"
+
+// log through an async logger and return the logged lines
+template<typename F>
+static std::string deferred_log(F&& log_calls)
+{
+    std::ostringstream oss;
+    {
+        auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+        spdlog::async_logger logger("deferred", oss_sink, 128);
+        logger.set_pattern("%v|");
+        log_calls(logger);
+    }
+    std::string lines = oss.str();
+    std::string eol = spdlog::details::os::eol();
+    for (auto pos = lines.find(eol); pos != std::string::npos; pos = lines.find(eol, pos))
+        lines.erase(pos, eol.size());
+    return lines;
+}
+
+TEST_CASE("deferred_literal_formats", "[deferred_format]")
+{
+    auto logged = deferred_log([](spdlog::async_logger& logger)
+    {
+        logger.info("Hello");
+        logger.info("Hello {} {:.1f} {} {}", 1, 2.25, 'c', true);
+        logger.info("{:08d}", 12);
+        logger.info() << "stream " << 1;
+        logger.info("mixed {}", 2) << " and stream";
+    });
+    REQUIRE(logged == "Hello|Hello 1 2.2 c true|00000012|stream 1|mixed 2 and stream|");
+}
+
+TEST_CASE("deferred_non_literal_formats", "[deferred_format]")
+{
+    auto logged = deferred_log([](spdlog::async_logger& logger)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            // the format string is gone (and its memory reused) before the worker thread formats the message
+            std::string fmt = "non literal " + std::to_string(i) + " {}";
+            logger.info(fmt.c_str(), i * 10);
+            std::fill(fmt.begin(), fmt.end(), 'x');
+        }
+        // too long to be copied into the queue slot, formatted right away
+        std::string long_fmt(300, 'l');
+        long_fmt += " {}";
+        logger.info(long_fmt.c_str(), 42);
+        std::fill(long_fmt.begin(), long_fmt.end(), 'x');
+    });
+    REQUIRE(logged == "non literal 0 0|non literal 1 10|non literal 2 20|" + std::string(300, 'l') + " 42|");
+}
+
+TEST_CASE("deferred_max_args", "[deferred_format]")
+{
+    auto logged = deferred_log([](spdlog::async_logger& logger)
+    {
+        // up to 8 arithmetic args are deferred, more are formatted right away
+        logger.info("{}{}{}{}{}{}{}{}", 1, 2, 3, 4, 5, 6, 7, 8);
+        logger.info("{}{}{}{}{}{}{}{}{}", 1, 2, 3, 4, 5, 6, 7, 8, 9);
+    });
+    REQUIRE(logged == "12345678|123456789|");
+}
+
+TEST_CASE("deferred_format_errors", "[deferred_format]")
+{
+    auto logged = deferred_log([](spdlog::async_logger& logger)
+    {
+        // deferred: reported in the logged text
+        REQUIRE_NOTHROW(logger.info("{} {}", 1));
+        // not deferred (non arithmetic arg): thrown to the caller
+        REQUIRE_THROWS_AS(logger.info("{} {}", std::string("text")), spdlog::spdlog_ex);
+    });
+    REQUIRE(logged.find("formatting error while processing format string '{} {}'") == 0);
+}
+
+TEST_CASE("deferred_binary_records", "[deferred_format]")
+{
+    std::string filename = "logs/deferred_binary.bin";
+    std::remove(filename.c_str());
+    std::ostringstream oss;
+    auto log_calls = [](spdlog::async_logger& logger)
+    {
+        SPDLOG_LOGGER_INFO(&logger, "ints {} {} {} {} {:x}", -1, 2u, -3000000000LL, 4000000000ULL, 255);
+        SPDLOG_LOGGER_WARN(&logger, "others {:.2f} {} {} {}", 2.25, true, 'c', 1.5L);
+        SPDLOG_LOGGER_INFO(&logger, "error {} {}", 1);
+        logger.info("no site {}", 1);
+        SPDLOG_LOGGER_INFO(&logger, "text {}", "arg");
+    };
+    {
+        // the messages of the binary sink alone are not formatted
+        auto binary_sink = std::make_shared<spdlog::sinks::binary_file_sink_mt>(filename);
+        spdlog::async_logger logger("binary", binary_sink, 128);
+        log_calls(logger);
+    }
+    {
+        auto binary_sink = std::make_shared<spdlog::sinks::binary_file_sink_mt>(filename);
+        auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+        spdlog::async_logger logger("binary", { binary_sink, oss_sink }, 128);
+        logger.set_pattern("%v|");
+        log_calls(logger);
+    }
+
+    std::ifstream ifs(filename, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    // the text is only in the second session, the first one has the args of the call sites
+    auto first_text = contents.find("ints -1");
+    REQUIRE(first_text != std::string::npos);
+    REQUIRE(contents.find("ints -1", first_text + 1) == std::string::npos);
+    REQUIRE(contents.find("no site 1") < first_text);
+
+    spdlog::pattern_formatter formatter("%v|");
+    spdlog::details::binary_log::reader reader(filename);
+    spdlog::details::log_msg msg;
+    std::string decoded;
+    while (reader.next(msg))
+    {
+        formatter.format(msg);
+        decoded += msg.formatted.str();
+    }
+    std::string text = oss.str();
+    std::string eol = spdlog::details::os::eol();
+    for (auto str : { &decoded, &text })
+        for (auto pos = str->find(eol); pos != std::string::npos; pos = str->find(eol, pos))
+            str->erase(pos, eol.size());
+
+    // both sessions decode to what the text sink got
+    REQUIRE(text.find("ints -1 2 -3000000000 4000000000 ff|others 2.25 true c 1.5|"
+                      "formatting error while processing format string 'error {} {}'") == 0);
+    REQUIRE(text.find("|no site 1|text arg|") != std::string::npos);
+    REQUIRE(decoded == text + text);
+}
@@ -1,4 +1,5 @@
 #include "includes.h"
+#include "../include/spdlog/sinks/binary_file_sink.h"
 
 static std::string file_contents(const std::string& filename)
 {
@@ -99,6 +100,23 @@ TEST_CASE("rotating_file_logger2", "[rotating_logger]]")
 }
 
 
+TEST_CASE("async_rotating_file_logger", "[rotating_logger]]")
+{
+    prepare_logdir();
+    std::string basename = "logs/rotating_log";
+    {
+        auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(basename, "txt", 1024, 1);
+        spdlog::async_logger logger("logger", sink, 128);
+        for (int i = 0; i < 1000; i++)
+            logger.info("Test message {}", i);
+    }
+
+    // the batches written by the async worker must not cross the size limit
+    REQUIRE(filesize(basename + ".txt") <= 1024);
+    REQUIRE(filesize(basename + ".1.txt") <= 1024);
+}
+
+
 TEST_CASE("daily_logger", "[daily_logger]]")
 {
 
@@ -118,15 +136,108 @@ TEST_CASE("daily_logger", "[daily_logger]]")
 }
 
 
+// render the messages of a binary log file with the given pattern
+static std::string decode_binary_log(const std::string& filename, const std::string& pattern)
+{
+    spdlog::pattern_formatter formatter(pattern);
+    spdlog::details::binary_log::reader reader(filename);
+    spdlog::details::log_msg msg;
+    std::string decoded;
+    while (reader.next(msg))
+    {
+        formatter.format(msg);
+        decoded += msg.formatted.str();
+    }
+    return decoded;
+}
 
+TEST_CASE("binary_file_logger", "[binary_logger]]")
+{
+    prepare_logdir();
+    std::string filename = "logs/binary_log.bin";
+    const char* pattern = "[%Y-%m-%d %H:%M:%S.%f] [%n] [%l] [%t] %s:%# %! %v";
+    std::ostringstream oss;
+    auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_st>(oss);
+
+    // the second session is appended to the file, with a new logger and the same call sites
+    for (int session = 0; session < 2; ++session)
+    {
+        auto binary_sink = std::make_shared<spdlog::sinks::binary_file_sink_st>(filename);
+        spdlog::logger logger(session ? "second" : "first", { binary_sink, oss_sink });
+        logger.set_pattern(pattern);
+        for (int i = 0; i < 3; ++i)
+            SPDLOG_LOGGER_INFO(&logger, "Test message {}", i);
+        SPDLOG_LOGGER_ERROR(&logger, "{} and {}", "text", 2.5);
+        logger.warn("no source {}", session);
+        logger.info() << "empty fields " << std::string(300, 'x');
+        logger.flush();
+    }
+
+    REQUIRE(decode_binary_log(filename, pattern) == oss.str());
+
+    std::string expected;
+    for (auto& no_source : { "no source 0", "no source 1" })
+    {
+        for (auto& text : { "Test message 0", "Test message 1", "Test message 2", "text and 2.5", no_source })
+            expected += std::string(text) + spdlog::details::os::eol();
+        expected += "empty fields " + std::string(300, 'x') + spdlog::details::os::eol();
+    }
+    REQUIRE(decode_binary_log(filename, "%v") == expected);
+}
 
+TEST_CASE("async_binary_file_logger", "[binary_logger]]")
+{
+    prepare_logdir();
+    std::string filename = "logs/binary_log.bin";
+    std::ostringstream oss;
+    {
+        auto binary_sink = std::make_shared<spdlog::sinks::binary_file_sink_mt>(filename);
+        auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+        spdlog::async_logger logger("async", { binary_sink, oss_sink }, 128);
+        logger.set_pattern("%+ %@");
+        for (int i = 0; i < 1000; i++)
+            SPDLOG_LOGGER_INFO(&logger, "Test message {}", i);
+    }
+
+    REQUIRE(decode_binary_log(filename, "%+ %@") == oss.str());
+}
 
-
-
-
-
-
-
-
-
-
+TEST_CASE("binary_file_errors", "[binary_logger]]")
+{
+    prepare_logdir();
+    REQUIRE_THROWS_AS(spdlog::details::binary_log::reader("logs/no_such_file.bin"), spdlog::spdlog_ex);
+
+    std::string filename = "logs/binary_log.bin";
+    {
+        spdlog::logger logger("truncated", std::make_shared<spdlog::sinks::binary_file_sink_st>(filename));
+        logger.info("Test message");
+    }
+    std::ifstream ifs(filename, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    ifs.close();
+    std::ofstream(filename, std::ios::binary) << contents.substr(0, contents.size() - 1);
+    REQUIRE_THROWS_AS(decode_binary_log(filename, "%v"), spdlog::spdlog_ex);
+
+    std::ofstream(filename, std::ios::binary) << "Test message\n";
+    REQUIRE_THROWS_AS(decode_binary_log(filename, "%v"), spdlog::spdlog_ex);
+
+    // a corrupted string size, larger than the file
+    std::string corrupted = contents.substr(0, 9);
+    corrupted += static_cast<char>(spdlog::details::binary_log::name_tag);
+    uint32_t id = 1, size = 0xfffffff0;
+    corrupted.append(reinterpret_cast<const char*>(&id), sizeof(id));
+    corrupted.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    std::ofstream(filename, std::ios::binary) << corrupted << "name";
+    REQUIRE_THROWS_AS(decode_binary_log(filename, "%v"), spdlog::spdlog_ex);
+
+    // corrupted dictionary ids, beyond the entries read so far
+    for (auto tag : { spdlog::details::binary_log::name_tag, spdlog::details::binary_log::site_tag })
+    {
+        corrupted = contents.substr(0, 9);
+        corrupted += static_cast<char>(tag);
+        id = 0xfffffff0;
+        corrupted.append(reinterpret_cast<const char*>(&id), sizeof(id));
+        std::ofstream(filename, std::ios::binary) << corrupted << std::string(32, '\0');
+        REQUIRE_THROWS_AS(decode_binary_log(filename, "%v"), spdlog::spdlog_ex);
+    }
+}
@@ -88,3 +88,216 @@ TEST_CASE("invalid_format", "[format]")
 
 
 
+
+
+//sink that logs each message it gets to another logger
+struct forwarding_sink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>
+{
+    explicit forwarding_sink(spdlog::logger& target) :_target(target) {}
+    void _sink_it(const spdlog::details::log_msg& msg) override
+    {
+        _target.info() << "forwarded " << msg.raw.c_str();
+    }
+    void flush() override
+    {}
+    spdlog::logger& _target;
+};
+
+//logs when its thread exits
+struct log_at_exit
+{
+    ~log_at_exit()
+    {
+        if (target)
+            target->info() << "at exit";
+    }
+    spdlog::logger* target = nullptr;
+};
+
+TEST_CASE("recycled_log_msg", "[format]")
+{
+    std::ostringstream oss;
+    spdlog::logger oss_logger("oss", std::make_shared<spdlog::sinks::ostream_sink_st>(oss));
+    oss_logger.set_pattern("%v");
+    auto eol = std::string(spdlog::details::os::eol());
+
+    //long messages grow the recycled buffers, shorter ones after them must not see their leftovers
+    std::string long_msg(2000, 'x');
+    std::string huge_msg(100 * 1024, 'y');
+    oss_logger.info() << long_msg;
+    oss_logger.info() << huge_msg;
+    oss_logger.info("short {}", 1);
+    REQUIRE(oss.str() == long_msg + eol + huge_msg + eol + "short 1" + eol);
+
+    //logging from within a sink, while the thread's message is in use
+    oss.str("");
+    spdlog::logger forwarding_logger("forwarding", std::make_shared<forwarding_sink>(oss_logger));
+    forwarding_logger.info("hello {}", 2);
+    forwarding_logger.info() << "world";
+    REQUIRE(oss.str() == "forwarded hello 2" + eol + "forwarded world" + eol);
+
+    //logging from a thread local destroyed after the thread's recycled message
+    oss.str("");
+    std::thread([&oss_logger]()
+    {
+        static thread_local log_at_exit at_exit;
+        at_exit.target = &oss_logger;
+        oss_logger.info("in thread");
+    }).join();
+    REQUIRE(oss.str() == "in thread" + eol + "at exit" + eol);
+
+    //a line_logger moved to another thread, which logs and releases the message there
+    using spdlog::details::line_logger;
+    using spdlog::details::recycled_log_msg;
+    oss.str("");
+    {
+        auto line = oss_logger.info();
+        line << "moved";
+        std::thread([](line_logger moved)
+        {
+            moved << " away";
+        }, std::move(line)).join();
+    }
+    REQUIRE(oss.str() == "moved away" + eol);
+    //the thread's message is free again (no recycling with visual studio 2013)
+    auto recycled = recycled_log_msg::instance();
+    REQUIRE((!recycled || recycled->state == recycled_log_msg::free_state));
+
+    //and released after the thread it came from exited
+    oss.str("");
+    std::unique_ptr<line_logger> orphan;
+    std::thread([&]()
+    {
+        orphan.reset(new line_logger(oss_logger.info()));
+        *orphan << "orphan";
+    }).join();
+    orphan.reset();
+    REQUIRE(oss.str() == "orphan" + eol);
+}
+
+
+//formatter counting its calls
+struct counting_formatter : public spdlog::formatter
+{
+    void format(spdlog::details::log_msg& msg) override
+    {
+        ++count;
+        msg.formatted << msg.raw.c_str();
+    }
+    int count = 0;
+};
+
+//sink using the raw message only
+struct raw_sink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>
+{
+    void _sink_it(const spdlog::details::log_msg& msg) override
+    {
+        raw.push_back(msg.raw.str());
+        formatted.push_back(msg.formatted.str());
+    }
+    void flush() override
+    {}
+    bool needs_formatted() const override
+    {
+        return false;
+    }
+    std::vector<std::string> raw, formatted;
+};
+
+TEST_CASE("lazy_formatting", "[format]")
+{
+    auto formatter = std::make_shared<counting_formatter>();
+    auto raw_sink1 = std::make_shared<raw_sink>();
+    auto raw_sink2 = std::make_shared<raw_sink>();
+
+    //no sink needs the formatted text
+    spdlog::logger raw_logger("raw", { raw_sink1, std::make_shared<spdlog::sinks::null_sink_st>() });
+    raw_logger.set_formatter(formatter);
+    raw_logger.info("hello {}", 1);
+    REQUIRE(formatter->count == 0);
+    REQUIRE(raw_sink1->raw == std::vector<std::string> { "hello 1" });
+    REQUIRE(raw_sink1->formatted == std::vector<std::string> { "" });
+
+    //formatted once, for the first sink that needs it
+    std::ostringstream oss;
+    auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_st>(oss);
+    spdlog::logger mixed_logger("mixed", { raw_sink2, oss_sink, std::make_shared<spdlog::sinks::ostream_sink_st>(oss) });
+    mixed_logger.set_formatter(formatter);
+    mixed_logger.info("world");
+    REQUIRE(formatter->count == 1);
+    REQUIRE(raw_sink2->raw == std::vector<std::string> { "world" });
+    REQUIRE(oss.str() == "worldworld");
+}
+
+TEST_CASE("sink_formatters", "[format]")
+{
+    std::ostringstream default_oss, verbose_oss, terse_oss;
+    auto default_sink = std::make_shared<spdlog::sinks::ostream_sink_st>(default_oss);
+    auto verbose_sink1 = std::make_shared<spdlog::sinks::ostream_sink_st>(verbose_oss);
+    auto verbose_sink2 = std::make_shared<spdlog::sinks::ostream_sink_st>(verbose_oss);
+    auto terse_sink = std::make_shared<spdlog::sinks::ostream_sink_st>(terse_oss);
+    auto raw = std::make_shared<raw_sink>();
+
+    auto verbose_formatter = std::make_shared<counting_formatter>();
+    auto terse_formatter = std::make_shared<counting_formatter>();
+    verbose_sink1->set_formatter(verbose_formatter);
+    verbose_sink2->set_formatter(verbose_formatter);
+    terse_sink->set_formatter(terse_formatter);
+    terse_sink->set_pattern("%l %v");
+    raw->set_formatter(verbose_formatter);
+    REQUIRE(verbose_sink1->get_formatter() == verbose_formatter);
+    REQUIRE(!default_sink->get_formatter());
+
+    spdlog::logger logger("sink_formatters", { verbose_sink1, terse_sink, raw, default_sink, verbose_sink2 });
+    logger.set_pattern("[%n] %v");
+    logger.info("hello");
+    logger.warn("world");
+
+    auto eol = std::string(spdlog::details::os::eol());
+    REQUIRE(default_oss.str() == "[sink_formatters] hello" + eol + "[sink_formatters] world" + eol);
+    REQUIRE(verbose_oss.str() == "hellohelloworldworld");
+    REQUIRE(terse_oss.str() == "info hello" + eol + "warning world" + eol);
+    REQUIRE(raw->raw.size() == 2);
+    REQUIRE(raw->raw[1] == "world");
+    //formatted once per message for the three sinks sharing it
+    REQUIRE(verbose_formatter->count == 2);
+    REQUIRE(terse_formatter->count == 0);
+}
+
+TEST_CASE("level_checked_macros", "[format]")
+{
+    std::ostringstream oss;
+    auto logger = std::make_shared<spdlog::logger>("macros", std::make_shared<spdlog::sinks::ostream_sink_st>(oss));
+    logger->set_pattern("%l %v");
+    logger->set_level(spdlog::level::info);
+
+    int evaluated = 0;
+    auto arg = [&]()
+    {
+        return ++evaluated;
+    };
+    int logger_evaluated = 0;
+    auto get_logger = [&]()
+    {
+        ++logger_evaluated;
+        return logger;
+    };
+
+    SPDLOG_LOGGER_TRACE(logger, "{}", arg());
+    SPDLOG_LOGGER_DEBUG(get_logger(), "{}", arg());
+    REQUIRE(evaluated == 0);
+    REQUIRE(oss.str().empty());
+
+    SPDLOG_LOGGER_INFO(get_logger(), "info {}", arg());
+    SPDLOG_LOGGER_ERROR(logger.get(), "plain message");
+    auto eol = std::string(spdlog::details::os::eol());
+    REQUIRE(evaluated == 1);
+    REQUIRE(logger_evaluated == 2);
+    REQUIRE(oss.str() == "info info 1" + eol + "error plain message" + eol);
+
+    if (evaluated)
+        SPDLOG_LOGGER_WARN(logger, "in if");
+    else
+        SPDLOG_LOGGER_WARN(logger, "in else");
+    REQUIRE(oss.str().find("in else") == std::string::npos);
+}
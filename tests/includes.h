@@ -6,6 +6,13 @@
 #include <ostream>
 #include <chrono>
 #include <exception>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include "catch.hpp"
 #include "../include/spdlog/spdlog.h"
@@ -0,0 +1,146 @@
+// calls below debug are compiled out in this file
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
+#include "includes.h"
+
+// keeps the source location of the logged messages
+struct source_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+    void _sink_it(const spdlog::details::log_msg& msg) override
+    {
+        sources.push_back(msg.source);
+        raw.push_back(msg.raw.str());
+    }
+    void flush() override
+    {}
+    std::vector<const spdlog::source_loc*> sources;
+    std::vector<std::string> raw;
+};
+
+static bool ends_with(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+TEST_CASE("active_level", "[macros]")
+{
+    auto sink = std::make_shared<source_sink>();
+    spdlog::logger logger("active_level", sink);
+    logger.set_level(spdlog::level::trace);
+
+    // compiled out: the arguments are not even compiled
+    SPDLOG_LOGGER_TRACE(&logger, "{}", no_such_variable);
+    REQUIRE(sink->raw.empty());
+
+    for (int i = 0; i < 2; ++i)
+        SPDLOG_LOGGER_DEBUG(&logger, "debug {}", i);
+    int line = __LINE__ - 1;
+    SPDLOG_LOGGER_EMERG(&logger, "emerg");
+    logger.info("no source");
+
+    REQUIRE(sink->raw == (std::vector<std::string> { "debug 0", "debug 1", "emerg", "no source" }));
+    // one static source_loc per call site
+    REQUIRE(sink->sources[0] == sink->sources[1]);
+    REQUIRE(sink->sources[0] != sink->sources[2]);
+    REQUIRE(ends_with(sink->sources[0]->filename, "macros.cpp"));
+    REQUIRE(sink->sources[0]->line == line);
+    REQUIRE(std::string(sink->sources[0]->funcname).size() > 0);
+    REQUIRE(sink->sources[3] == nullptr);
+}
+
+TEST_CASE("async_source_loc", "[macros]")
+{
+    auto sink = std::make_shared<source_sink>();
+    {
+        spdlog::async_logger logger("async_source_loc", sink, 128);
+        SPDLOG_LOGGER_WARN(&logger, "warn {}", 1);
+        logger.warn("no source");
+    }
+    REQUIRE(sink->raw.size() == 2);
+    REQUIRE(sink->sources[0] != nullptr);
+    REQUIRE(ends_with(sink->sources[0]->filename, "macros.cpp"));
+    REQUIRE(sink->sources[1] == nullptr);
+}
+
+TEST_CASE("call_site_metadata", "[macros]")
+{
+    auto sink = std::make_shared<source_sink>();
+    spdlog::logger logger("call_site_metadata", sink);
+    const char* runtime_fmt = "runtime {}";
+    SPDLOG_LOGGER_ERROR(&logger, "error {} {}", 1, 2);
+    SPDLOG_LOGGER_INFO(&logger, runtime_fmt, 3);
+    SPDLOG_LOGGER_INFO(&logger, "no args");
+
+    REQUIRE(sink->raw == (std::vector<std::string> { "error 1 2", "runtime 3", "no args" }));
+    auto error_site = sink->sources[0];
+    REQUIRE(error_site->level == spdlog::level::err);
+    REQUIRE(std::string(error_site->fmt) == "error {} {}");
+    REQUIRE(sink->sources[1]->level == spdlog::level::info);
+    REQUIRE(sink->sources[1]->fmt == nullptr);
+    REQUIRE(std::string(sink->sources[2]->fmt) == "no args");
+
+    // distinct, stable ids
+    REQUIRE(error_site->id() != sink->sources[1]->id());
+    REQUIRE(error_site->id() == error_site->id());
+
+    std::ostringstream oss;
+    auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_st>(oss);
+    oss_sink->set_pattern("%s:%# %! %v");
+    spdlog::logger oss_logger("source_pattern", oss_sink);
+    SPDLOG_LOGGER_WARN(&oss_logger, "where");
+    int line = __LINE__ - 1;
+    REQUIRE(oss.str().find("macros.cpp:" + std::to_string(line) + " ") == 0);
+    REQUIRE(oss.str().find(" where") != std::string::npos);
+}
+
+TEST_CASE("sampled_logging", "[macros]")
+{
+    auto sink = std::make_shared<source_sink>();
+    spdlog::logger logger("sampled", sink);
+
+    // 1 in 10
+    for (int i = 0; i < 25; ++i)
+        SPDLOG_LOGGER_SAMPLED(&logger, spdlog::level::info, 0, 10, "one in ten {}", i);
+    REQUIRE(sink->raw == (std::vector<std::string> { "one in ten 0", "one in ten 10 [9 similar messages suppressed]",
+                          "one in ten 20 [9 similar messages suppressed]" }));
+
+    // first 2, then every 3rd
+    sink->raw.clear();
+    for (int i = 0; i < 9; ++i)
+        SPDLOG_LOGGER_SAMPLED(&logger, spdlog::level::warn, 2, 3, "{}", i);
+    REQUIRE(sink->raw == (std::vector<std::string> { "0", "1", "2", "5 [2 similar messages suppressed]", "8 [2 similar messages suppressed]" }));
+
+    // disabled levels are neither logged nor counted as suppressed
+    sink->raw.clear();
+    logger.set_level(spdlog::level::err);
+    for (int i = 0; i < 5; ++i)
+        SPDLOG_LOGGER_SAMPLED(&logger, spdlog::level::info, 0, 2, "{}", i);
+    // compiled out below SPDLOG_ACTIVE_LEVEL
+    logger.set_level(spdlog::level::trace);
+    SPDLOG_LOGGER_SAMPLED(&logger, spdlog::level::trace, 1, 1, "trace");
+    REQUIRE(sink->raw.empty());
+}
+
+TEST_CASE("rate_limited_logging", "[macros]")
+{
+    auto sink = std::make_shared<source_sink>();
+    spdlog::logger logger("rate_limited", sink);
+
+    // start right after a second boundary, so the burst fits in a single second
+    auto second = std::chrono::duration_cast<std::chrono::seconds>(spdlog::details::os::now().time_since_epoch());
+    while (std::chrono::duration_cast<std::chrono::seconds>(spdlog::details::os::now().time_since_epoch()) == second)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    auto log_burst = [&](int count)
+    {
+        for (int i = 0; i < count; ++i)
+            SPDLOG_LOGGER_RATE_LIMITED(&logger, spdlog::level::warn, 3, "burst {}", i);
+    };
+    log_burst(1000);
+    REQUIRE(sink->raw == (std::vector<std::string> { "burst 0", "burst 1", "burst 2" }));
+
+    // next second
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    log_burst(1);
+    REQUIRE(sink->raw.size() == 4);
+    REQUIRE(sink->raw[3] == "burst 0 [997 similar messages suppressed]");
+}
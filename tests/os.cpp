@@ -0,0 +1,57 @@
+#include "includes.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+TEST_CASE("thread_id", "[os]")
+{
+    using spdlog::details::os::thread_id;
+
+    auto main_id = thread_id();
+    REQUIRE(main_id != 0);
+    REQUIRE(thread_id() == main_id);
+#ifndef SPDLOG_LOGICAL_THREAD_ID
+    REQUIRE(main_id == spdlog::details::os::os_thread_id());
+#endif
+
+    std::set<size_t> ids { main_id };
+    std::mutex ids_mutex;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            auto id = thread_id();
+            std::lock_guard<std::mutex> lock(ids_mutex);
+            ids.insert(id);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    REQUIRE(ids.size() == 5);
+}
+
+#ifdef __linux__
+TEST_CASE("thread_id_after_fork", "[os]")
+{
+    auto parent_id = spdlog::details::os::thread_id();
+    auto pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0)
+    {
+        // the child must not report the cached id of the forking thread
+        auto child_id = spdlog::details::os::thread_id();
+#ifndef SPDLOG_LOGICAL_THREAD_ID
+        if (child_id != spdlog::details::os::os_thread_id())
+            _exit(1);
+#endif
+        _exit(child_id != parent_id ? 0 : 1);
+    }
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
+#endif
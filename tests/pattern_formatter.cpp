@@ -0,0 +1,246 @@
+#include "includes.h"
+
+// format a message with the given pattern, time and text (without the eol)
+static std::string format_msg(const std::string& pattern, const spdlog::log_clock::time_point& time, const std::string& text = "some text")
+{
+    spdlog::details::log_msg msg(spdlog::level::info);
+    msg.logger_name = "pattern_tester";
+    msg.time = time;
+    msg.raw << text;
+    spdlog::pattern_formatter formatter(pattern);
+    formatter.format(msg);
+
+    auto eol_size = strlen(spdlog::details::os::eol());
+    return std::string(msg.formatted.data(), msg.formatted.size() - eol_size);
+}
+
+static std::string strftime_str(const char* format, std::time_t t)
+{
+    char buf[128];
+    auto tm = spdlog::details::os::localtime(t);
+    return std::string(buf, std::strftime(buf, sizeof(buf), format, &tm));
+}
+
+static bool same_tm(const std::tm& a, const std::tm& b)
+{
+    return a.tm_year == b.tm_year && a.tm_mon == b.tm_mon && a.tm_mday == b.tm_mday && a.tm_wday == b.tm_wday &&
+           a.tm_hour == b.tm_hour && a.tm_min == b.tm_min && a.tm_sec == b.tm_sec;
+}
+
+TEST_CASE("cached_localtime", "[pattern_formatter]")
+{
+    const std::time_t start = 1444000000;
+    // same second, later seconds in the same minute, next minutes, going back in time
+    const int offsets[] = { 0, 0, 1, 2, 30, 59, 60, 61, 119, 3600, 3599, -1, -3600, 86400 * 200 };
+    for (auto offset : offsets)
+    {
+        std::time_t t = start + offset;
+        REQUIRE(same_tm(spdlog::details::cached_localtime(t), spdlog::details::os::localtime(t)));
+    }
+}
+
+TEST_CASE("date_time_flags", "[pattern_formatter]")
+{
+    const std::time_t start = 1444000000;
+    for (int offset = 0; offset < 200; offset += 7)
+    {
+        std::time_t t = start + offset;
+        auto tp = spdlog::log_clock::from_time_t(t) + std::chrono::milliseconds(42);
+        REQUIRE(format_msg("%Y-%m-%d %H:%M:%S.%e", tp) == strftime_str("%Y-%m-%d %H:%M:%S.042", t));
+        REQUIRE(format_msg("%+", tp) == strftime_str("[%Y-%m-%d %H:%M:%S.042] [pattern_tester] [info] some text", t));
+    }
+}
+
+TEST_CASE("all_flags", "[pattern_formatter]")
+{
+    const std::time_t t = 1444000000;
+    auto tp = spdlog::log_clock::from_time_t(t) + std::chrono::nanoseconds(12345678);
+    REQUIRE(format_msg("%a %A %b %h %B", tp) == strftime_str("%a %A %b %b %B", t));
+    REQUIRE(format_msg("%C/%D/%x/%m/%d/%H/%M/%S", tp) == strftime_str("%y/%m/%d/%y/%m/%d/%y/%m/%d/%H/%M/%S", t));
+    REQUIRE(format_msg("%R|%T|%X", tp) == strftime_str("%H:%M|%H:%M:%S|%H:%M:%S", t));
+    REQUIRE(format_msg("%e %f %F", tp) == "012 012345 012345678");
+    REQUIRE(format_msg("%n %l %L %v", tp) == "pattern_tester info I some text");
+
+    auto tz = strftime_str("%z", t); // +hhmm
+    REQUIRE(format_msg("%z", tp) == tz.substr(0, 3) + ":" + tz.substr(3));
+
+    auto tm = spdlog::details::os::localtime(t);
+    REQUIRE(format_msg("%p", tp) == (tm.tm_hour >= 12 ? "PM" : "AM"));
+    REQUIRE(format_msg("%c", tp).size() >= strlen("Sun Oct 4 23:06:40 2015"));
+}
+
+// local time of the given day at 12:34:56
+static std::time_t local_day(int year, int month, int day)
+{
+    std::tm tm = std::tm();
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = 12;
+    tm.tm_min = 34;
+    tm.tm_sec = 56;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+TEST_CASE("long_month_names", "[pattern_formatter]")
+{
+    // "June", "July" and "Sept" are the longest abbreviated names, %c must fit them in a run
+    const struct
+    {
+        int month;
+        const char* name;
+    } months[] = { { 6, "June" }, { 7, "July" }, { 9, "Sept" } };
+    for (auto& month : months)
+    {
+        std::time_t t = local_day(2015, month.month, 23);
+        auto tp = spdlog::log_clock::from_time_t(t);
+        auto date_time = strftime_str("%a ", t) + month.name + strftime_str(" %d %H:%M:%S %Y", t);
+        REQUIRE(format_msg("%b|%B", tp) == month.name + strftime_str("|%B", t));
+        REQUIRE(format_msg("%cX%cX%cX%cX%cXXX", tp) == date_time + "X" + date_time + "X" + date_time + "X" + date_time + "X" + date_time + "XXX");
+    }
+}
+
+TEST_CASE("literals_and_runs", "[pattern_formatter]")
+{
+    const std::time_t t = 1444000000;
+    auto tp = spdlog::log_clock::from_time_t(t);
+    auto date = strftime_str("%Y-%m-%d", t);
+
+    // unknown flags and a trailing % sign
+    REQUIRE(format_msg("%Q %v %", tp) == "%Q some text ");
+    REQUIRE(format_msg("no flags", tp) == "no flags");
+
+    // literals too long to be inlined into a run
+    std::string long_literal(300, 'x');
+    REQUIRE(format_msg(long_literal + "%Y-%m-%d" + long_literal, tp) == long_literal + date + long_literal);
+
+    // more bounded fields than fit in a single run
+    std::string pattern, expected;
+    for (int i = 0; i < 20; ++i)
+    {
+        pattern += "%Y-%m-%d|";
+        expected += date + "|";
+    }
+    REQUIRE(format_msg(pattern, tp) == expected);
+
+    // long logger names are written around the run
+    std::string long_name(100, 'n');
+    spdlog::details::log_msg msg(spdlog::level::warn);
+    msg.logger_name = long_name;
+    msg.time = tp;
+    msg.raw << "text";
+    spdlog::pattern_formatter formatter("[%Y-%m-%d] [%n] [%l] %v");
+    formatter.format(msg);
+    REQUIRE(msg.formatted.str() == "[" + date + "] [" + long_name + "] [warning] text" + spdlog::details::os::eol());
+}
+
+SPDLOG_STATIC_PATTERN(static_full, "%+");
+SPDLOG_STATIC_PATTERN(static_custom, "[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
+SPDLOG_STATIC_PATTERN(static_all_flags, "%a %A %b %h %B %c %C %D %x %m %d %H %I %M %S %e %f %F %p %r %R %T %X %z %n %l %L %t %v");
+SPDLOG_STATIC_PATTERN(static_unknown_flags, "%Q literals only %%%");
+SPDLOG_STATIC_PATTERN(static_empty, "");
+SPDLOG_STATIC_PATTERN(static_source, "[%@] [%s] [%g] [%#] [%!] %v");
+SPDLOG_STATIC_PATTERN(static_date_times, "%c%c%c");
+
+template<typename Pattern>
+static void require_same_output(const std::string& logger_name, const spdlog::source_loc* source = nullptr, std::time_t t = 1444000000)
+{
+    spdlog::details::log_msg msg(spdlog::level::err);
+    msg.source = source;
+    msg.logger_name = logger_name;
+    msg.time = spdlog::log_clock::from_time_t(t) + std::chrono::nanoseconds(12345678);
+    msg.thread_id = 42;
+    msg.raw << "some text";
+
+    spdlog::pattern_formatter dynamic_formatter(Pattern::value());
+    dynamic_formatter.format(msg);
+    auto expected = msg.formatted.str();
+
+    msg.formatted.clear();
+    spdlog::static_pattern_formatter<Pattern> static_formatter;
+    static_formatter.format(msg);
+    REQUIRE(msg.formatted.str() == expected);
+}
+
+TEST_CASE("static_pattern_formatter", "[pattern_formatter]")
+{
+    for (auto& name : { std::string("static"), std::string(100, 'n') })
+    {
+        require_same_output<static_full>(name);
+        require_same_output<static_custom>(name);
+        require_same_output<static_all_flags>(name);
+        require_same_output<static_unknown_flags>(name);
+        require_same_output<static_empty>(name);
+        require_same_output<static_source>(name);
+    }
+    static const spdlog::source_loc source { "dir/file.cpp", 42, "function", spdlog::level::err, nullptr, { 0 } };
+    require_same_output<static_source>("static", &source);
+    // longer than the room reserved in runs
+    static const spdlog::source_loc long_source { "dir/a_file_with_a_very_very_long_name.cpp", 42,
+                                                  "a_function_with_a_very_very_long_name", spdlog::level::err, nullptr, { 0 } };
+    require_same_output<static_source>("static", &long_source);
+    // four letter abbreviated months
+    for (int month : { 6, 7, 9 })
+    {
+        require_same_output<static_date_times>("static", nullptr, local_day(2015, month, 23));
+        require_same_output<static_all_flags>("static", nullptr, local_day(2015, month, 23));
+    }
+
+    auto logger = std::make_shared<spdlog::logger>("static_logger", std::make_shared<spdlog::sinks::null_sink_st>());
+    logger->set_formatter(std::make_shared<spdlog::static_pattern_formatter<static_custom>>());
+    logger->info("Hello {}", "static");
+}
+
+TEST_CASE("write_padded", "[pattern_formatter]")
+{
+    char buf[16];
+    for (int width = 1; width <= 9; ++width)
+    {
+        for (int v : { 0, 1, 9, 10, 42, 99, 100, 999, 1000, 12345, 999999, 1000000, 123456789 })
+        {
+            auto end = spdlog::details::write_padded(buf, v, width);
+            // wider values are truncated to their last width digits
+            auto expected = fmt::format("{:0{}}", v, width);
+            REQUIRE(std::string(buf, end) == expected.substr(expected.size() - width));
+        }
+    }
+}
+
+SPDLOG_STATIC_PATTERN(static_iso, "%Y-%m-%dT%H:%M:%S|%Y-%m-%d %H:%M:%S|%Y-%m-%d %H|%Y|%Y-%m");
+
+TEST_CASE("iso_sequences", "[pattern_formatter]")
+{
+    const std::time_t t = 1444000000;
+    auto tp = spdlog::log_clock::from_time_t(t);
+    REQUIRE(format_msg(static_iso::value(), tp) == strftime_str("%Y-%m-%dT%H:%M:%S|%Y-%m-%d %H:%M:%S|%Y-%m-%d %H|%Y|%Y-%m", t));
+    require_same_output<static_iso>("iso");
+}
+
+TEST_CASE("source_location_flags", "[pattern_formatter]")
+{
+    static const spdlog::source_loc source { "/some/dir/some_file.cpp", 123, "some_function", spdlog::level::info, "some {}", { 0 } };
+    spdlog::details::log_msg msg(spdlog::level::info);
+    msg.logger_name = "pattern_tester";
+    msg.raw << "some text";
+    msg.source = &source;
+
+    spdlog::pattern_formatter formatter("[%@] [%s] [%g] [%#] [%!] %v");
+    formatter.format(msg);
+    auto eol = std::string(spdlog::details::os::eol());
+    REQUIRE(msg.formatted.str() == "[/some/dir/some_file.cpp:123] [some_file.cpp] [/some/dir/some_file.cpp] [123] [some_function] some text" + eol);
+
+    static const spdlog::source_loc long_source { "a/b/a_file_with_a_very_very_long_name.cpp", 1,
+                                                  "a_function_with_a_very_very_long_name", spdlog::level::info, nullptr, { 0 } };
+    msg.source = &long_source;
+    msg.formatted.clear();
+    formatter.format(msg);
+    REQUIRE(msg.formatted.str() == "[a/b/a_file_with_a_very_very_long_name.cpp:1] [a_file_with_a_very_very_long_name.cpp] "
+            "[a/b/a_file_with_a_very_very_long_name.cpp] [1] [a_function_with_a_very_very_long_name] some text" + eol);
+
+    // no source location
+    REQUIRE(format_msg("[%@] [%s] [%g] [%#] [%!] %v", spdlog::log_clock::now()) == "[] [] [] [] [] some text");
+
+    REQUIRE(source.id() != 0);
+    REQUIRE(source.id() == source.id());
+}
@@ -0,0 +1,73 @@
+#include "includes.h"
+#include "../include/spdlog/details/tsc_clock.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+// the system clock is used until the first calibration, and for good without an invariant TSC
+static bool wait_calibrated(spdlog::details::tsc_clock& clock, bool expected)
+{
+    clock.now();
+    for (int i = 0; i < 1000 && clock.calibrated() != expected; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return clock.calibrated() == expected;
+}
+
+static bool close_to_system_clock(spdlog::details::tsc_clock& clock)
+{
+    auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(clock.now() - spdlog::log_clock::now()).count();
+    return diff <= 1 && diff >= -1;
+}
+
+TEST_CASE("tsc_clock", "[tsc_clock]")
+{
+    auto& clock = spdlog::details::tsc_clock::instance();
+    wait_calibrated(clock, true);
+
+    // close to the system clock
+    REQUIRE(close_to_system_clock(clock));
+
+    // monotonic
+    auto last = clock.now();
+    int backwards = 0;
+    for (int i = 0; i < 100000; ++i)
+    {
+        auto now = clock.now();
+        if (now < last)
+            ++backwards;
+        last = now;
+    }
+    REQUIRE(backwards == 0);
+
+    // advances with the system clock
+    auto start = clock.now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock.now() - start).count();
+    REQUIRE(elapsed >= 19);
+    REQUIRE(elapsed < 1000);
+}
+
+#ifndef _WIN32
+TEST_CASE("tsc_clock_fork", "[tsc_clock]")
+{
+    auto& clock = spdlog::details::tsc_clock::instance();
+    wait_calibrated(clock, true);
+    bool calibrated = clock.calibrated();
+
+    auto pid = ::fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0)
+    {
+        // the calibration thread did not survive the fork: the child starts its own
+        bool ok = !clock.calibrated() && close_to_system_clock(clock) && wait_calibrated(clock, calibrated) &&
+                  close_to_system_clock(clock);
+        ::_exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    REQUIRE(::waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
+#endif
@@ -0,0 +1,61 @@
+/*************************************************************************/
+/* spdlog - an extremely fast and easy to use c++11 logging library.     */
+/* Copyright (c) 2014 Gabi Melman.                                       */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+//
+// Decode a binary log file written by spdlog::sinks::binary_file_sink back to text.
+// usage: binlog_decode <file> [pattern]
+// the pattern is any spdlog pattern (default "%+"), including the source location flags.
+//
+#include <cstdio>
+#include <iostream>
+#include "spdlog/spdlog.h"
+#include "spdlog/details/binary_log.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <file> [pattern]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        spdlog::pattern_formatter formatter(argc == 3 ? argv[2] : "%+");
+        spdlog::details::binary_log::reader reader(argv[1]);
+        spdlog::details::log_msg msg;
+        while (reader.next(msg))
+        {
+            formatter.format(msg);
+            std::fwrite(msg.formatted.data(), 1, msg.formatted.size(), stdout);
+        }
+        std::fflush(stdout);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "binlog_decode failed: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}